@@ -1,23 +1,43 @@
 #version 310 es
 
 precision mediump float;
+precision mediump sampler2DArray;
+precision highp int;
 
 // Uniforms
-layout(binding=0, std140) uniform MyUniformBlock
+layout(binding=0, std140) uniform FrameUniforms
 {
-  mat4 M;
-  mat4 MVP;
-  vec4 fragOffset;
+  mat4 VP;
   vec3 CameraPos;
   vec3 ambientLight;
-  vec3 LightPos[32];
-  vec3 LightColor[32];
-  int LightCount;
+  vec4 LightPos[256]; // w: attenuation bias, so the light fades out to zero at its range
+  vec3 LightColor[256];
+};
+
+layout(binding=1, std140) uniform DrawUniforms
+{
+  vec4 fragOffset;
+  vec4 positionOffset; // for mesh.vert
+  vec4 positionScale;
+  vec4 uvOffsetScale;
+  vec4 textureLayer; // x: layer of the texture arrays
+};
+
+// The lights of each cluster of the view frustum, see light_clusters.h
+layout(binding=2, std140) uniform LightClusters
+{
+  uvec4 ClusterRanges[512 / 4]; // per cluster: first index (low 16 bits), light count (high 16 bits)
+  uvec4 LightIndices[12 * 1024 / 16]; // 8 bits per light index
 };
 
-layout(binding = 1) uniform sampler2D DiffuseTex;
-layout(binding = 2) uniform sampler2D NormalTex;
-layout(binding = 3) uniform sampler2D EmissiveTex;
+// Must match light_clusters.h
+const ivec3 ClusterGridSize = ivec3(8, 4, 16);
+const float ClusterNearDepth = 0.1;
+const float ClusterFarDepth = 100.0;
+
+layout(binding = 1) uniform sampler2DArray DiffuseTex;
+layout(binding = 2) uniform sampler2DArray NormalTex;
+layout(binding = 3) uniform sampler2DArray EmissiveTex;
 
 // Input Vertex Attributes
 layout(location = 0) in vec2 UV;
@@ -30,7 +50,7 @@ layout(location = 0) out vec4 color;
 void main()
 {
   vec3 totalLight = vec3(0, 0, 0);
-  vec4 diffuse = texture(DiffuseTex, UV);
+  vec4 diffuse = texture(DiffuseTex, vec3(UV, textureLayer.x));
 
   // highlight
   totalLight += fragOffset.rgb;
@@ -39,17 +59,31 @@ void main()
   totalLight += ambientLight * diffuse.rgb;
 
   // emissive
-  totalLight += texture(EmissiveTex, UV).rgb * 5.0;
+  totalLight += texture(EmissiveTex, vec3(UV, textureLayer.x)).rgb * 5.0;
 
-  vec3 localN = texture(NormalTex, UV).rgb * 2.0 - 1.0;
+  vec3 localN = texture(NormalTex, vec3(UV, textureLayer.x)).rgb * 2.0 - 1.0;
   vec3 normal = normalize(TBN * localN);
 
-  // dynamic lights
-  for(int i=0;i < LightCount;++i)
+  // dynamic lights: only the ones of the cluster of the fragment
+  vec4 clipPos = VP * vec4(vPos, 1);
+  vec2 ndc = clipPos.xy / clipPos.w;
+  ivec2 tile = clamp(ivec2((ndc * 0.5 + 0.5) * vec2(ClusterGridSize.xy)), ivec2(0), ClusterGridSize.xy - 1);
+  float depthRatio = log(max(clipPos.w, ClusterNearDepth) / ClusterNearDepth) / log(ClusterFarDepth / ClusterNearDepth);
+  int slice = min(int(depthRatio * float(ClusterGridSize.z)), ClusterGridSize.z - 1);
+  uint cluster = uint((slice * ClusterGridSize.y + tile.y) * ClusterGridSize.x + tile.x);
+
+  uint range = ClusterRanges[cluster / 4u][cluster % 4u];
+  uint firstIndex = range & 0xFFFFu;
+  uint lightCount = range >> 16u;
+
+  for(uint k = 0u; k < lightCount; ++k)
   {
-    vec3 lightDir = normalize(LightPos[i] - vPos);
-    float lightDist = length(LightPos[i] - vPos);
-    float attenuation = 10.0/(lightDist*lightDist*lightDist);
+    uint n = firstIndex + k;
+    int i = int((LightIndices[n / 16u][(n / 4u) % 4u] >> (8u * (n % 4u))) & 0xFFu);
+
+    vec3 lightDir = normalize(LightPos[i].xyz - vPos);
+    float lightDist = length(LightPos[i].xyz - vPos);
+    float attenuation = max(0.0, 10.0/(lightDist*lightDist*lightDist) - LightPos[i].w);
     float incidenceRatio = max(0.0, dot(lightDir, normal));
 
     // diffuse
@@ -62,7 +96,7 @@ void main()
     vec3 halfwayDir = normalize((viewDir + lightDir) * 0.5);
     float angle = max(dot(normal, halfwayDir), 0.0);
     float spec = pow(angle, material_shininess);
-    totalLight += LightColor[i] * (spec * material_specular);
+    totalLight += LightColor[i] * (spec * material_specular) * sign(attenuation);
   }
 
   color.rgb = totalLight;
@@ -70,7 +104,7 @@ void main()
 
   if(false)
   {
-    color.rgb = texture(NormalTex, UV).rgb;
+    color.rgb = texture(NormalTex, vec3(UV, textureLayer.x)).rgb;
     color.a = 1.0;
   }
 }
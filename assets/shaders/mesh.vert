@@ -1,41 +1,62 @@
 #version 310 es
 
 // Uniforms
-layout(binding=0, std140) uniform MyUniformBlock
+layout(binding=0, std140) uniform FrameUniforms
 {
-  mat4 M;
-  mat4 MVP;
-  vec4 fragOffset;
+  mat4 VP;
   vec3 CameraPos;
   vec3 ambientLight;
-  vec3 LightPos[32];
-  vec3 LightColor[32];
-  int LightCount;
+  vec4 LightPos[256]; // for mesh.frag
+  vec3 LightColor[256];
+};
+
+layout(binding=1, std140) uniform DrawUniforms
+{
+  vec4 fragOffset;
+  vec4 positionOffset;
+  vec4 positionScale;
+  vec4 uvOffsetScale;
+  vec4 textureLayer; // for mesh.frag
 };
 
-// Input Vertex Attributes
-layout(location = 0) in vec4 vertexPos_model;
-layout(location = 1) in vec2 vertexUV;
-layout(location = 2) in vec3 a_normal;
-layout(location = 3) in vec3 a_binormal;
-layout(location = 4) in vec3 a_tangent;
+// Input Vertex Attributes (packed, see SingleRenderMesh::PackedVertex)
+layout(location = 0) in vec4 a_position; // xyz: quantized, w: tangent frame handedness
+layout(location = 1) in vec2 a_uv; // quantized
+layout(location = 2) in vec2 a_normal; // octahedral
+layout(location = 4) in vec2 a_tangent; // octahedral
+layout(location = 5) in mat4 M; // per instance
 
 // Output Vertex Attributes
 layout(location = 0) out vec2 UV;
 layout(location = 1) out vec3 vPos;
 layout(location = 2) out mat3 TBN;
 
+vec3 octDecode(vec2 e)
+{
+  vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+  float t = max(-n.z, 0.0);
+  n.x += n.x >= 0.0 ? -t : t;
+  n.y += n.y >= 0.0 ? -t : t;
+  return normalize(n);
+}
+
 void main()
 {
-  gl_Position = MVP * vertexPos_model;
-  UV = vertexUV;
+  vec4 vertexPos_model = vec4(positionOffset.xyz + positionScale.xyz * a_position.xyz, 1);
+  vec4 worldPos = M * vertexPos_model;
+  gl_Position = VP * worldPos;
+  UV = uvOffsetScale.xy + uvOffsetScale.zw * a_uv;
+
+  vPos = worldPos.xyz;
 
-  vPos = (M * vertexPos_model).xyz;
+  vec3 normal = octDecode(a_normal);
+  vec3 tangent = octDecode(a_tangent);
+  vec3 binormal = cross(normal, tangent) * (a_position.w * 2.0 - 1.0);
 
   // create tangent-space matrix
-  vec3 T = normalize(M * vec4(a_tangent, 0)).xyz;
-  vec3 B = normalize(M * vec4(a_binormal, 0)).xyz;
-  vec3 N = normalize(M * vec4(a_normal, 0)).xyz;
+  vec3 T = normalize(M * vec4(tangent, 0)).xyz;
+  vec3 B = normalize(M * vec4(binormal, 0)).xyz;
+  vec3 N = normalize(M * vec4(normal, 0)).xyz;
   TBN = mat3(T, B, N);
 }
 // vim: syntax=glsl
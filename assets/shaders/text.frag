@@ -5,7 +5,7 @@ precision mediump float;
 // Uniforms
 layout(std140, binding=0) uniform MyUniformBlock
 {
-  mat4 MVP;
+  vec4 Placement; // xy: offset, zw: scale
 };
 
 layout(binding=1) uniform sampler2D DiffuseTex;
@@ -3,7 +3,7 @@
 // Uniforms
 layout(std140, binding=0) uniform MyUniformBlock
 {
-  mat4 MVP;
+  vec4 Placement; // xy: offset, zw: scale
 };
 
 // Attributes
@@ -15,7 +15,7 @@ layout(location = 0) out vec2 UV;
 
 void main()
 {
-  gl_Position = vec4(inTransfo, 0, 1);
+  gl_Position = vec4(inTransfo * Placement.zw + Placement.xy, 0, 1);
   UV = inUV;
 }
 // vim: syntax=glsl
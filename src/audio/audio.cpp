@@ -10,6 +10,7 @@
 #include "base/logger.h"
 #include "engine/audio.h"
 #include "misc/file.h" // exists
+#include "misc/resource_cache.h"
 #include "misc/stats.h"
 #include "sound.h"
 
@@ -17,12 +18,17 @@
 #include <cassert>
 #include <cmath> // sin
 #include <memory>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
 namespace
 {
 Gauge ggAudioVoices("Audio voices");
+Gauge ggSoundCacheMegabytes("Sound cache (MB)");
+Gauge ggSoundCacheHits("Sound cache hits");
+Gauge ggSoundCacheMisses("Sound cache misses");
+Gauge ggSoundCacheEvictions("Sound cache evictions");
 
 template<typename T>
 struct Fifo
@@ -104,12 +110,22 @@ struct BleepSound : Sound
 
     return std::make_unique<BleepSoundSource>();
   }
+
+  int64_t getSize() const override { return 0; }
 };
 
 struct HighLevelAudio : MixableAudio
 {
   HighLevelAudio() : m_bleepSound(std::make_shared<BleepSound>())
   {
+    m_soundCache.onCacheMiss = [] (String path, int64_t& bytes)
+      {
+        auto r = loadSoundFile(path);
+        bytes = r->getSize();
+        return r;
+      };
+
+    m_soundCache.budget = int64_t(32) << 20;
   }
 
   void loadSound(int id, String path) override
@@ -127,7 +143,24 @@ struct HighLevelAudio : MixableAudio
       return;
     }
 
-    m_sounds.insert({ id, loadSoundFile(path) });
+    m_sounds.insert({ id, m_soundCache.fetch(std::string(path.data, path.len)) });
+    reportCacheStats();
+  }
+
+  void unloadSound(int id) override
+  {
+    // voices still playing this sound keep their own reference
+    m_sounds.erase(id);
+    m_soundCache.trim();
+    reportCacheStats();
+  }
+
+  void reportCacheStats()
+  {
+    ggSoundCacheMegabytes = m_soundCache.getBytes() / (1024.0 * 1024.0);
+    ggSoundCacheHits = m_soundCache.stats.hits;
+    ggSoundCacheMisses = m_soundCache.stats.misses;
+    ggSoundCacheEvictions = m_soundCache.stats.evictions;
   }
 
   VoiceId createVoice() override
@@ -178,6 +211,7 @@ struct HighLevelAudio : MixableAudio
 
   // Shared read-only data (Resources)
   std::unordered_map<int, std::shared_ptr<Sound>> m_sounds;
+  ResourceCache<std::string, Sound> m_soundCache; // kept after unloading, until over budget
   std::shared_ptr<BleepSound> m_bleepSound;
 
   /////////////////////////////////////////////////////////////////////////////
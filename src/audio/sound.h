@@ -8,6 +8,7 @@
 
 #include "base/span.h"
 #include "base/string.h"
+#include <cstdint>
 #include <memory>
 
 // A sound being played (holds the current sound position)
@@ -25,6 +26,9 @@ struct Sound
 {
   virtual ~Sound() = default;
   virtual std::unique_ptr<IAudioSource> createSource() = 0;
+
+  // memory held by the sound, in bytes
+  virtual int64_t getSize() const = 0;
 };
 
 std::unique_ptr<Sound> loadSoundFile(String filename);
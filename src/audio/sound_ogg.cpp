@@ -48,6 +48,8 @@ struct OggSound : Sound
     return std::make_unique<OggSoundPlayer>(data);
   }
 
+  int64_t getSize() const override { return m_data.size(); }
+
   const std::string m_data;
 };
 
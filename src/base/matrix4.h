@@ -9,6 +9,11 @@
 #include <cassert>
 #include <cmath>
 
+#if defined(__SSE2__) || defined(_M_X64)
+#define MATRIX4_SIMD 1
+#include <emmintrin.h> // SSE2
+#endif
+
 #include "geom.h"
 #include "quaternion.h"
 
@@ -49,8 +54,13 @@ struct Matrix4f
   row data[4];
 };
 
+namespace matrix4
+{
+// Reference implementations, always available (e.g for testing the SIMD ones)
+namespace scalar
+{
 inline
-Matrix4f operator * (Matrix4f const& A, Matrix4f const& B)
+Matrix4f multiply(Matrix4f const& A, Matrix4f const& B)
 {
   Matrix4f r(0);
 
@@ -69,7 +79,7 @@ Matrix4f operator * (Matrix4f const& A, Matrix4f const& B)
 }
 
 inline
-Vec4f operator * (Matrix4f const& A, Vec4f v)
+Vec4f transform(Matrix4f const& A, Vec4f v)
 {
   Vec4f r;
 
@@ -81,6 +91,328 @@ Vec4f operator * (Matrix4f const& A, Vec4f v)
   return r;
 }
 
+inline
+Matrix4f transpose(const Matrix4f& m)
+{
+  Matrix4f r(0);
+
+  for(int row = 0; row < 4; ++row)
+    for(int col = 0; col < 4; ++col)
+      r[row][col] = m[col][row];
+
+  return r;
+}
+
+inline
+Matrix4f invertStandardMatrix(const Matrix4f& m)
+{
+  const Vec3f u(m[0][0], m[1][0], m[2][0]);
+  const Vec3f v(m[0][1], m[1][1], m[2][1]);
+  const Vec3f w(m[0][2], m[1][2], m[2][2]);
+  const Vec3f t(m[0][3], m[1][3], m[2][3]);
+
+  Matrix4f r(0);
+
+  r[0][0] = u.x;
+  r[0][1] = u.y;
+  r[0][2] = u.z;
+
+  r[1][0] = v.x;
+  r[1][1] = v.y;
+  r[1][2] = v.z;
+
+  r[2][0] = w.x;
+  r[2][1] = w.y;
+  r[2][2] = w.z;
+
+  r[0][3] = -dotProduct(u, t);
+  r[1][3] = -dotProduct(v, t);
+  r[2][3] = -dotProduct(w, t);
+
+  r[3][3] = 1;
+
+  return r;
+}
+
+inline
+Matrix4f quaternionToMatrix(const Quaternion& q)
+{
+  const auto qx = q.v.x;
+  const auto qy = q.v.y;
+  const auto qz = q.v.z;
+  const auto qw = q.s;
+
+  Matrix4f r(0);
+
+  r[0][0] = 1.0f - 2.0f * qy * qy - 2.0f * qz * qz;
+  r[1][0] = 2.0f * qx * qy - 2.0f * qz * qw;
+  r[2][0] = 2.0f * qx * qz + 2.0f * qy * qw;
+  r[3][0] = 0;
+
+  r[0][1] = 2.0f * qx * qy + 2.0f * qz * qw;
+  r[1][1] = 1.0f - 2.0f * qx * qx - 2.0f * qz * qz;
+  r[2][1] = 2.0f * qy * qz - 2.0f * qx * qw;
+  r[3][1] = 0;
+
+  r[0][2] = 2.0f * qx * qz - 2.0f * qy * qw;
+  r[1][2] = 2.0f * qy * qz + 2.0f * qx * qw;
+  r[2][2] = 1.0f - 2.0f * qx * qx - 2.0f * qy * qy;
+  r[3][2] = 0;
+
+  r[0][3] = 0;
+  r[1][3] = 0;
+  r[2][3] = 0;
+  r[3][3] = 1;
+
+  return r;
+}
+
+inline
+void transformVectors(Matrix4f const& A, float w, float* vectors, int count, int stride)
+{
+  for(int i = 0; i < count; ++i)
+  {
+    auto p = (float*)((char*)vectors + i * stride);
+    const auto r = transform(A, Vec4f { p[0], p[1], p[2], w });
+    p[0] = r.x;
+    p[1] = r.y;
+    p[2] = r.z;
+  }
+}
+}
+
+#if MATRIX4_SIMD
+// SSE implementations. Matrix4f isn't aligned, hence the unaligned loads.
+namespace simd
+{
+struct Rows
+{
+  __m128 r[4];
+};
+
+inline Rows load(Matrix4f const& m)
+{
+  return { { _mm_loadu_ps(m[0].elements), _mm_loadu_ps(m[1].elements), _mm_loadu_ps(m[2].elements), _mm_loadu_ps(m[3].elements) } };
+}
+
+inline Matrix4f store(Rows const& rows)
+{
+  Matrix4f r;
+
+  for(int i = 0; i < 4; ++i)
+    _mm_storeu_ps(r[i].elements, rows.r[i]);
+
+  return r;
+}
+
+inline
+Matrix4f multiply(Matrix4f const& A, Matrix4f const& B)
+{
+  const auto b = load(B);
+  Rows r;
+
+  for(int i = 0; i < 4; ++i)
+  {
+    auto sum = _mm_mul_ps(_mm_set1_ps(A[i][0]), b.r[0]);
+    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(A[i][1]), b.r[1]));
+    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(A[i][2]), b.r[2]));
+    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(A[i][3]), b.r[3]));
+    r.r[i] = sum;
+  }
+
+  return store(r);
+}
+
+inline
+Vec4f transform(Matrix4f const& A, Vec4f v)
+{
+  const auto vec = _mm_set_ps(v.w, v.z, v.y, v.x);
+
+  const auto m0 = _mm_mul_ps(_mm_loadu_ps(A[0].elements), vec);
+  const auto m1 = _mm_mul_ps(_mm_loadu_ps(A[1].elements), vec);
+  const auto m2 = _mm_mul_ps(_mm_loadu_ps(A[2].elements), vec);
+  const auto m3 = _mm_mul_ps(_mm_loadu_ps(A[3].elements), vec);
+
+  // horizontal sums of m0, m1, m2 and m3
+  const auto s01 = _mm_add_ps(_mm_unpacklo_ps(m0, m1), _mm_unpackhi_ps(m0, m1));
+  const auto s23 = _mm_add_ps(_mm_unpacklo_ps(m2, m3), _mm_unpackhi_ps(m2, m3));
+  const auto sum = _mm_add_ps(_mm_movelh_ps(s01, s23), _mm_movehl_ps(s23, s01));
+
+  Vec4f r;
+  _mm_storeu_ps(&r.x, sum);
+  return r;
+}
+
+inline
+Matrix4f transpose(const Matrix4f& m)
+{
+  auto a = load(m);
+  _MM_TRANSPOSE4_PS(a.r[0], a.r[1], a.r[2], a.r[3]);
+  return store(a);
+}
+
+// The result is the transpose of: the 3 first rows of 'm' without their
+// translation, plus a row made of the translation of 'm' projected on each axis.
+inline
+Matrix4f invertStandardMatrix(const Matrix4f& m)
+{
+  const auto noW = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+
+  auto a = load(m);
+
+  // columns: u, v, w, t
+  auto u = a.r[0];
+  auto v = a.r[1];
+  auto w = a.r[2];
+  auto t = a.r[3];
+  _MM_TRANSPOSE4_PS(u, v, w, t);
+  t = _mm_and_ps(t, noW);
+
+  // (dot(u,t), dot(v,t), dot(w,t), 0)
+  auto du = _mm_mul_ps(u, t);
+  auto dv = _mm_mul_ps(v, t);
+  auto dw = _mm_mul_ps(w, t);
+  auto zero = _mm_setzero_ps();
+  _MM_TRANSPOSE4_PS(du, dv, dw, zero);
+  const auto dots = _mm_add_ps(_mm_add_ps(du, dv), dw);
+
+  Rows r;
+  r.r[0] = _mm_and_ps(a.r[0], noW);
+  r.r[1] = _mm_and_ps(a.r[1], noW);
+  r.r[2] = _mm_and_ps(a.r[2], noW);
+  r.r[3] = _mm_sub_ps(_mm_set_ps(1, 0, 0, 0), dots);
+  _MM_TRANSPOSE4_PS(r.r[0], r.r[1], r.r[2], r.r[3]);
+
+  return store(r);
+}
+
+// Each row is: identity + a*b*S1 + c*d*S2,
+// where a, b, c and d are permutations of the quaternion, and S1, S2 hold the factors (+/-2).
+inline
+Matrix4f quaternionToMatrix(const Quaternion& quat)
+{
+  const auto q = _mm_set_ps(quat.s, quat.v.z, quat.v.y, quat.v.x);
+
+#define QUAT_ROW(a, b, c, d, s1, s2, identity) \
+        _mm_add_ps(identity, \
+                   _mm_add_ps( \
+                     _mm_mul_ps(_mm_mul_ps(_mm_shuffle_ps(q, q, a), _mm_shuffle_ps(q, q, b)), s1), \
+                     _mm_mul_ps(_mm_mul_ps(_mm_shuffle_ps(q, q, c), _mm_shuffle_ps(q, q, d)), s2)))
+
+  Rows r;
+
+  // (1 - 2yy - 2zz, 2xy + 2zw, 2xz - 2yw, 0)
+  r.r[0] = QUAT_ROW(_MM_SHUFFLE(3, 0, 0, 1), _MM_SHUFFLE(3, 2, 1, 1),
+                    _MM_SHUFFLE(3, 1, 2, 2), _MM_SHUFFLE(3, 3, 3, 2),
+                    _mm_set_ps(0, 2, 2, -2), _mm_set_ps(0, -2, 2, -2),
+                    _mm_set_ps(0, 0, 0, 1));
+
+  // (2xy - 2zw, 1 - 2xx - 2zz, 2yz + 2xw, 0)
+  r.r[1] = QUAT_ROW(_MM_SHUFFLE(3, 1, 0, 0), _MM_SHUFFLE(3, 2, 0, 1),
+                    _MM_SHUFFLE(3, 0, 2, 2), _MM_SHUFFLE(3, 3, 2, 3),
+                    _mm_set_ps(0, 2, -2, 2), _mm_set_ps(0, 2, -2, -2),
+                    _mm_set_ps(0, 0, 1, 0));
+
+  // (2xz + 2yw, 2yz - 2xw, 1 - 2xx - 2yy, 0)
+  r.r[2] = QUAT_ROW(_MM_SHUFFLE(3, 0, 1, 0), _MM_SHUFFLE(3, 0, 2, 2),
+                    _MM_SHUFFLE(3, 1, 0, 1), _MM_SHUFFLE(3, 1, 3, 3),
+                    _mm_set_ps(0, -2, 2, 2), _mm_set_ps(0, -2, -2, 2),
+                    _mm_set_ps(0, 1, 0, 0));
+
+#undef QUAT_ROW
+
+  r.r[3] = _mm_set_ps(1, 0, 0, 0);
+
+  return store(r);
+}
+
+inline
+void transformVectors(Matrix4f const& A, float w, float* vectors, int count, int stride)
+{
+  auto cols = load(A);
+  _MM_TRANSPOSE4_PS(cols.r[0], cols.r[1], cols.r[2], cols.r[3]);
+
+  const auto offset = _mm_mul_ps(cols.r[3], _mm_set1_ps(w));
+
+  for(int i = 0; i < count; ++i)
+  {
+    auto p = (float*)((char*)vectors + i * stride);
+
+    auto r = _mm_add_ps(_mm_mul_ps(cols.r[0], _mm_set1_ps(p[0])), offset);
+    r = _mm_add_ps(r, _mm_mul_ps(cols.r[1], _mm_set1_ps(p[1])));
+    r = _mm_add_ps(r, _mm_mul_ps(cols.r[2], _mm_set1_ps(p[2])));
+
+    // only write x, y, z: the next float might belong to something else
+    _mm_storel_pi((__m64*)p, r);
+    _mm_store_ss(p + 2, _mm_movehl_ps(r, r));
+  }
+}
+}
+
+namespace best = simd;
+#else
+namespace best = scalar;
+#endif
+}
+
+// The public entry points use the SIMD kernels only where they are faster
+// (see the 'Matrix4: kernels' benchmark). For a single vector or a single matrix,
+// the shuffles cost more than what the compiler makes of the scalar code.
+
+inline
+Matrix4f operator * (Matrix4f const& A, Matrix4f const& B)
+{
+  return matrix4::best::multiply(A, B);
+}
+
+inline
+Vec4f operator * (Matrix4f const& A, Vec4f v)
+{
+  return matrix4::scalar::transform(A, v);
+}
+
+inline
+Matrix4f transpose(const Matrix4f& m)
+{
+  return matrix4::scalar::transpose(m);
+}
+
+// Inverts a transform/rotate/scale matrix.
+//
+// [ux vx wx tx]      [ux uy uz -dot(u,t)]
+// [uy vy wy ty] ---> [vx vy vz -dot(v,t)]
+// [uz vz wz tz]      [wx wy wz -dot(w,t)]
+// [ 0  0  0  1]      [ 0  0  0     1    ]
+inline
+Matrix4f invertStandardMatrix(const Matrix4f& m)
+{
+  return matrix4::scalar::invertStandardMatrix(m);
+}
+
+inline
+Matrix4f quaternionToMatrix(const Quaternion& q)
+{
+  return matrix4::scalar::quaternionToMatrix(q);
+}
+
+// Batched transforms, in place. Each element is 3 floats (x, y, z),
+// 'stride' bytes apart, so they can be fields of a vertex structure.
+// The 'w' component of the result is dropped.
+
+// w = 1: translation applies
+inline
+void transformPoints(Matrix4f const& A, float* points, int count, int stride)
+{
+  matrix4::best::transformVectors(A, 1, points, count, stride);
+}
+
+// w = 0: directions, e.g normals
+inline
+void transformDirections(Matrix4f const& A, float* directions, int count, int stride)
+{
+  matrix4::best::transformVectors(A, 0, directions, count, stride);
+}
+
 inline
 Matrix4f translate(Vec3f v)
 {
@@ -109,18 +441,6 @@ Matrix4f scale(Vec3f v)
   return r;
 }
 
-inline
-Matrix4f transpose(const Matrix4f& m)
-{
-  Matrix4f r(0);
-
-  for(int row = 0; row < 4; ++row)
-    for(int col = 0; col < 4; ++col)
-      r[row][col] = m[col][row];
-
-  return r;
-}
-
 inline
 Matrix4f rotateX(float angle)
 {
@@ -184,43 +504,6 @@ Matrix4f rotateZ(float angle)
   return r;
 }
 
-// Inverts a transform/rotate/scale matrix.
-//
-// [ux vx wx tx]      [ux uy uz -dot(u,t)]
-// [uy vy wy ty] ---> [vx vy vz -dot(v,t)]
-// [uz vz wz tz]      [wx wy wz -dot(w,t)]
-// [ 0  0  0  1]      [ 0  0  0     1    ]
-inline
-Matrix4f invertStandardMatrix(const Matrix4f& m)
-{
-  const Vec3f u(m[0][0], m[1][0], m[2][0]);
-  const Vec3f v(m[0][1], m[1][1], m[2][1]);
-  const Vec3f w(m[0][2], m[1][2], m[2][2]);
-  const Vec3f t(m[0][3], m[1][3], m[2][3]);
-
-  Matrix4f r(0);
-
-  r[0][0] = u.x;
-  r[0][1] = u.y;
-  r[0][2] = u.z;
-
-  r[1][0] = v.x;
-  r[1][1] = v.y;
-  r[1][2] = v.z;
-
-  r[2][0] = w.x;
-  r[2][1] = w.y;
-  r[2][2] = w.z;
-
-  r[0][3] = -dotProduct(u, t);
-  r[1][3] = -dotProduct(v, t);
-  r[2][3] = -dotProduct(w, t);
-
-  r[3][3] = 1;
-
-  return r;
-}
-
 inline
 Matrix4f lookAt(Vec3f eye, Vec3f center, Vec3f up)
 {
@@ -262,37 +545,3 @@ Matrix4f perspective(float fovy, float aspect, float zNear, float zFar)
   r[2][3] = -(2.0 * zFar * zNear) / (zFar - zNear);
   return r;
 }
-
-inline
-Matrix4f quaternionToMatrix(const Quaternion& q)
-{
-  const auto qx = q.v.x;
-  const auto qy = q.v.y;
-  const auto qz = q.v.z;
-  const auto qw = q.s;
-
-  Matrix4f r(0);
-
-  r[0][0] = 1.0f - 2.0f * qy * qy - 2.0f * qz * qz;
-  r[1][0] = 2.0f * qx * qy - 2.0f * qz * qw;
-  r[2][0] = 2.0f * qx * qz + 2.0f * qy * qw;
-  r[3][0] = 0;
-
-  r[0][1] = 2.0f * qx * qy + 2.0f * qz * qw;
-  r[1][1] = 1.0f - 2.0f * qx * qx - 2.0f * qz * qz;
-  r[2][1] = 2.0f * qy * qz - 2.0f * qx * qw;
-  r[3][1] = 0;
-
-  r[0][2] = 2.0f * qx * qz - 2.0f * qy * qw;
-  r[1][2] = 2.0f * qy * qz + 2.0f * qx * qw;
-  r[2][2] = 1.0f - 2.0f * qx * qx - 2.0f * qy * qy;
-  r[3][2] = 0;
-
-  r[0][3] = 0;
-  r[1][3] = 0;
-  r[2][3] = 0;
-  r[3][3] = 1;
-
-  return r;
-}
-
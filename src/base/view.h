@@ -8,11 +8,17 @@
 
 #pragma once
 
+#include <algorithm> // max
+#include <cmath> // cbrt
+#include <memory>
+
 #include "geom.h"
 #include "quaternion.h"
 #include "resource.h"
 #include "string.h"
 
+struct Pvs;
+
 enum class Effect
 {
   Normal,
@@ -36,12 +42,28 @@ struct Actor
   Effect effect = Effect::Normal;
 };
 
+// Lights are ignored where their contribution (10/d³, see mesh.frag) falls under this
+const float LightCutoff = 1.0f / 256;
+
+// Distance where the contribution of a light falls under 'LightCutoff'.
+// 'intensity' is its brightest color channel.
+inline float getLightRange(float intensity)
+{
+  return std::cbrt(10 * intensity / LightCutoff);
+}
+
 struct LightActor
 {
   Vec3f pos; // light position, in logical units
   Vec3f color;
   float pulsePeriod = 0;
   float pulseAmplitude = 0;
+
+  // at the peak of the pulse
+  float getRange() const
+  {
+    return getLightRange(std::max(color.x, std::max(color.y, color.z)) * (1 + pulseAmplitude));
+  }
 };
 
 // This interface should act as a message sink.
@@ -51,7 +73,21 @@ struct View
   virtual ~View() = default;
 
   virtual void setTitle(String gameTitle) = 0;
+
+  // resource management:
+  // a declared resource only gets loaded on its first use,
+  // while a preloaded resource gets loaded immediately.
+  virtual void declare(Resource res) = 0;
   virtual void preload(Resource res) = 0;
+
+  // evicts the resources that weren't used since the previous call.
+  // Meant to be called on level change.
+  virtual void evictUnusedResources() = 0;
+
+  // visibility of a model (i.e a room), shared with the renderer for culling.
+  // Can be null.
+  virtual void setModelPvs(int modelId, std::shared_ptr<const Pvs> pvs) = 0;
+
   virtual void textBox(String msg) = 0;
   virtual void playMusic(int id) = 0;
   virtual void stopMusic() = 0;
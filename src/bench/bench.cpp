@@ -0,0 +1,46 @@
+// Copyright (C) 2026 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+// Benchmark framework: runner
+
+#include "bench.h"
+#include <cstdio>
+#include <cstring> // strstr
+
+static Benchmark* g_first;
+
+BenchmarkRegistration registerBenchmark(Benchmark& benchmark)
+{
+  // append, so benchmarks run in declaration order
+  Benchmark** last = &g_first;
+
+  while(*last)
+    last = &(*last)->next;
+
+  *last = &benchmark;
+  return {};
+}
+
+void reportMeasure(const char* caption, int iterations, int64_t totalUs)
+{
+  auto const perIteration = iterations > 0 ? double(totalUs) / iterations : 0.0;
+  printf("  %-40s %12.2f us/iter (%d iterations)\n", caption, perIteration, iterations);
+  fflush(stdout);
+}
+
+void runBenchmarks(const char* filter)
+{
+  printf("Running benchmarks.\n");
+
+  for(auto bench = g_first; bench; bench = bench->next)
+  {
+    if(!strstr(bench->name, filter))
+      continue;
+
+    printf("%s\n", bench->name);
+    bench->func();
+  }
+}
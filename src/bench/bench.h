@@ -0,0 +1,55 @@
+// Copyright (C) 2026 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+#pragma once
+
+///////////////////////////////////////////////////////////////////////////////
+// User-code API
+
+#include "misc/time.h"
+#include <cstdint>
+
+#define benchmark(name) \
+        benchmarkWithCounter(__COUNTER__, name)
+
+void runBenchmarks(const char* filter);
+void reportMeasure(const char* caption, int iterations, int64_t totalUs);
+
+// Calls 'func' 'iterations' times, and prints the average duration of one call.
+template<typename Lambda>
+void measure(const char* caption, int iterations, Lambda func)
+{
+  auto const t0 = GetSteadyClockUs();
+
+  for(int i = 0; i < iterations; ++i)
+    func();
+
+  auto const t1 = GetSteadyClockUs();
+
+  reportMeasure(caption, iterations, t1 - t0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// implementation details
+
+struct Benchmark
+{
+  void (* func)();
+  const char* name;
+  Benchmark* next = nullptr;
+};
+
+#define benchmarkWithCounter(counter, name) \
+        benchmark2(counter, name)
+
+#define benchmark2(counter, name) \
+        static void g_myBenchmark ## counter(); \
+        static Benchmark g_myBenchmarkInfo ## counter = { &g_myBenchmark ## counter, name }; \
+        static auto g_registration ## counter = registerBenchmark(g_myBenchmarkInfo ## counter); \
+        static void g_myBenchmark ## counter()
+
+struct BenchmarkRegistration {};
+BenchmarkRegistration registerBenchmark(Benchmark& benchmark);
@@ -0,0 +1,36 @@
+// Copyright (C) 2026 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+// Benchmark framework: entry point
+
+#include "base/error.h"
+#include "bench.h"
+#include <cstdio>
+#include <exception>
+
+int main(int argc, char* argv[])
+{
+  char const* filter = "";
+
+  if(argc == 2)
+    filter = argv[1];
+
+  try
+  {
+    runBenchmarks(filter);
+    return 0;
+  }
+  catch(const Error& e)
+  {
+    fprintf(stderr, "Fatal: %.*s\n", e.msg.len, e.msg.data);
+    return 1;
+  }
+  catch(const std::exception& e)
+  {
+    fprintf(stderr, "Fatal: %s\n", e.what());
+    return 1;
+  }
+}
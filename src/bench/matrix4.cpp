@@ -0,0 +1,140 @@
+// Copyright (C) 2026 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+// Matrix kernels: scalar versus SIMD
+
+#include "base/matrix4.h"
+#include "base/string.h"
+#include "bench.h"
+#include <vector>
+
+namespace
+{
+// keeps the compiler from optimizing the computations away
+volatile float g_sink;
+
+struct Vertex
+{
+  float x, y, z;
+  float nx, ny, nz;
+  float u, v;
+};
+
+template<typename Kernels>
+void measureKernels(const char* name)
+{
+  const int N = 1000;
+
+  std::vector<Matrix4f> matrices;
+  std::vector<Quaternion> quaternions;
+
+  for(int i = 0; i < N; ++i)
+  {
+    const auto q = Quaternion::fromEuler(i * 0.1, i * 0.2, i * 0.3);
+    quaternions.push_back(q);
+    matrices.push_back(translate(Vec3f(i, 1, 2)) * quaternionToMatrix(q));
+  }
+
+  std::vector<Vertex> vertices(10000);
+
+  for(int i = 0; i < (int)vertices.size(); ++i)
+    vertices[i] = { float(i), 1, 2, 0, 0, 1, 0, 0 };
+
+  char caption[256];
+
+  auto label = [&] (const char* what)
+    {
+      format(caption, "%s: %s", name, what);
+      return caption;
+    };
+
+  measure(label("1000 multiply"), 1000, [&] ()
+    {
+      Matrix4f acc = matrices[0];
+
+      for(auto& m : matrices)
+        acc = Kernels::multiply(m, acc);
+
+      g_sink = acc[0][0];
+    });
+
+  measure(label("1000 transform"), 1000, [&] ()
+    {
+      Vec4f acc = { 1, 2, 3, 1 };
+
+      for(auto& m : matrices)
+        acc = Kernels::transform(m, acc);
+
+      g_sink = acc.x;
+    });
+
+  measure(label("1000 transpose"), 1000, [&] ()
+    {
+      float acc = 0;
+
+      for(auto& m : matrices)
+        acc += Kernels::transpose(m)[0][3];
+
+      g_sink = acc;
+    });
+
+  measure(label("1000 invert"), 1000, [&] ()
+    {
+      float acc = 0;
+
+      for(auto& m : matrices)
+        acc += Kernels::invertStandardMatrix(m)[0][3];
+
+      g_sink = acc;
+    });
+
+  measure(label("1000 quaternionToMatrix"), 1000, [&] ()
+    {
+      float acc = 0;
+
+      for(auto& q : quaternions)
+        acc += Kernels::quaternionToMatrix(q)[1][0];
+
+      g_sink = acc;
+    });
+
+  measure(label("10000 points"), 1000, [&] ()
+    {
+      Kernels::transformVectors(matrices[1], 1, &vertices[0].x, vertices.size(), sizeof(Vertex));
+      g_sink = vertices[0].x;
+    });
+}
+
+struct Scalar
+{
+  static Matrix4f multiply(Matrix4f const& a, Matrix4f const& b) { return matrix4::scalar::multiply(a, b); }
+  static Vec4f transform(Matrix4f const& a, Vec4f v) { return matrix4::scalar::transform(a, v); }
+  static Matrix4f transpose(Matrix4f const& m) { return matrix4::scalar::transpose(m); }
+  static Matrix4f invertStandardMatrix(Matrix4f const& m) { return matrix4::scalar::invertStandardMatrix(m); }
+  static Matrix4f quaternionToMatrix(Quaternion const& q) { return matrix4::scalar::quaternionToMatrix(q); }
+  static void transformVectors(Matrix4f const& m, float w, float* p, int n, int stride) { matrix4::scalar::transformVectors(m, w, p, n, stride); }
+};
+
+#if MATRIX4_SIMD
+struct Simd
+{
+  static Matrix4f multiply(Matrix4f const& a, Matrix4f const& b) { return matrix4::simd::multiply(a, b); }
+  static Vec4f transform(Matrix4f const& a, Vec4f v) { return matrix4::simd::transform(a, v); }
+  static Matrix4f transpose(Matrix4f const& m) { return matrix4::simd::transpose(m); }
+  static Matrix4f invertStandardMatrix(Matrix4f const& m) { return matrix4::simd::invertStandardMatrix(m); }
+  static Matrix4f quaternionToMatrix(Quaternion const& q) { return matrix4::simd::quaternionToMatrix(q); }
+  static void transformVectors(Matrix4f const& m, float w, float* p, int n, int stride) { matrix4::simd::transformVectors(m, w, p, n, stride); }
+};
+#endif
+}
+
+benchmark("Matrix4: kernels")
+{
+  measureKernels<Scalar>("scalar");
+#if MATRIX4_SIMD
+  measureKernels<Simd>("simd");
+#endif
+}
@@ -0,0 +1,129 @@
+// Copyright (C) 2026 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+// Renderer: CPU cost of turning actors into draw calls
+
+#include "bench.h"
+#include "engine/graphics_backend.h"
+#include "engine/renderer.h"
+#include "render/picture.h"
+#include <cstdlib> // rand
+#include <memory>
+#include <vector>
+
+IRenderer* createRenderer(IGraphicsBackend* backend);
+
+namespace
+{
+// Does nothing: only the renderer side gets measured
+struct NullBackend : IGraphicsBackend
+{
+  struct Program : IGpuProgram {};
+
+  struct Texture : ITexture
+  {
+    void upload(PictureView) override {}
+    void uploadMipChain(CookedTexture const&, int) override {}
+    void setNoRepeat() override {}
+    void bind(int) override {}
+  };
+
+  struct VertexBuffer : IVertexBuffer
+  {
+    void upload(const void*, size_t) override {}
+    void update(size_t, const void*, size_t) override {}
+  };
+
+  struct IndexBuffer : IIndexBuffer
+  {
+    void upload(const void*, int, int) override {}
+  };
+
+  struct FrameBuffer : IFrameBuffer
+  {
+    ITexture* getColorTexture() override { return &texture; }
+    Texture texture;
+  };
+
+  void setFullscreen(bool) override {}
+  void setCaption(String) override {}
+  void enableGrab(bool) override {}
+  void readPixels(Span<uint8_t>) override {}
+
+  std::unique_ptr<ITexture> createTexture() override { return std::make_unique<Texture>(); }
+  std::unique_ptr<IVertexBuffer> createVertexBuffer(bool) override { return std::make_unique<VertexBuffer>(); }
+  std::unique_ptr<IIndexBuffer> createIndexBuffer() override { return std::make_unique<IndexBuffer>(); }
+  std::unique_ptr<IFrameBuffer> createFrameBuffer(Vec2i, bool) override { return std::make_unique<FrameBuffer>(); }
+  std::unique_ptr<IGpuProgram> createGpuProgram(String, bool) override { return std::make_unique<Program>(); }
+
+  void setScreenSizeListener(IScreenSizeListener* listener) override { listener->onScreenSizeChanged(Vec2i(1280, 720)); }
+
+  void setRenderTarget(IFrameBuffer*) override {}
+  void useGpuProgram(IGpuProgram*) override {}
+  void useVertexBuffer(IVertexBuffer*) override {}
+  void useIndexBuffer(IIndexBuffer*) override {}
+  void enableVertexAttribute(int, int, int, int, AttributeFormat) override {}
+  void setUniformBlock(void*, size_t, int) override {}
+  void draw(int, int) override {}
+  void enableInstanceAttribute(int, int, int, int) override {}
+  void drawInstanced(int, int, int) override {}
+  void drawIndexedInstanced(int, int, int) override {}
+  void clear() override {}
+  void swap() override {}
+};
+
+struct Placement
+{
+  Rect3f where;
+  Quaternion orientation;
+  int modelId;
+};
+}
+
+benchmark("Renderer: 10k actors")
+{
+  NullBackend backend;
+  std::unique_ptr<IRenderer> renderer(createRenderer(&backend));
+
+  // no model file: each one falls back on a box
+  const int ModelCount = 8;
+
+  for(int i = 0; i < ModelCount; ++i)
+    renderer->loadModel(i, "nonexistent.render");
+
+  renderer->setCamera(Vec3f(0, 0, 0), Quaternion::identity()); // looking towards +x
+
+  // scattered around the camera: most of them are in view
+  srand(1234);
+
+  auto random = [] (float min, float max)
+    {
+      return min + (max - min) * (rand() / float(RAND_MAX));
+    };
+
+  std::vector<Placement> actors;
+
+  for(int i = 0; i < 10000; ++i)
+  {
+    Placement p;
+    p.where.pos = Vec3f(random(-20, 200), random(-100, 100), random(-20, 20));
+    p.where.size = Vec3f(1, 1, 1);
+    p.orientation = Quaternion::fromEuler(random(0, 6.28f), 0, 0);
+    p.modelId = i % ModelCount;
+    actors.push_back(p);
+  }
+
+  auto submit = [&] ()
+    {
+      renderer->beginDraw();
+
+      for(auto& actor : actors)
+        renderer->drawActor(actor.where, actor.orientation, actor.modelId, false);
+    };
+
+  measure("submit", 100, submit);
+  measure("submit + render", 100, [&] () { submit(); renderer->endDraw(); });
+}
@@ -0,0 +1,58 @@
+// Copyright (C) 2026 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+// Level loading: room parsing and entity spawning
+
+#include "base/string.h"
+#include "bench.h"
+#include "gameplay/entity.h"
+#include "gameplay/room.h"
+#include "misc/file.h"
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+namespace
+{
+struct NullGame : IGame
+{
+  void textBox(String) override {}
+  void playSound(int, const Vec3f*) override {}
+  void spawn(Entity* e) override { spawned.push_back(std::unique_ptr<Entity>(e)); }
+  void postEvent(std::unique_ptr<Event>) override {}
+  std::unique_ptr<Handle> subscribeForEvents(IEventSink*) override { return nullptr; }
+
+  std::vector<std::unique_ptr<Entity>> spawned;
+};
+}
+
+benchmark("Level loading: all rooms")
+{
+  int roomCount = 0;
+
+  for(int levelIdx = 0; levelIdx < 100; ++levelIdx)
+  {
+    char buf[256];
+    const auto filename = format(buf, "res/rooms/%02d/room.fbx", levelIdx);
+
+    if(!File::exists(filename))
+      continue;
+
+    ++roomCount;
+
+    auto room = loadRoom(filename);
+
+    char caption[256];
+    format(caption, "room %02d: load (%d things)", levelIdx, (int)room.things.size());
+    measure(caption, 10, [&] () { loadRoom(filename); });
+
+    format(caption, "room %02d: spawn", levelIdx);
+    measure(caption, 1000, [&] () { NullGame game; spawnEntities(room, &game); });
+  }
+
+  if(roomCount == 0)
+    printf("  no room found in 'res/rooms' (run 'make resources' first)\n");
+}
@@ -10,7 +10,10 @@
 
 #include "app.h"
 
+#include <algorithm>
 #include <cmath>
+#include <cstdlib> // srand, atof, atoi
+#include <map>
 #include <memory>
 #include <string>
 #include <vector>
@@ -30,11 +33,14 @@
 #include "input.h"
 #include "ratecounter.h"
 #include "renderer.h"
+#include "replay.h"
+#include "state_filter.h"
 #include "video_capture.h"
 
 auto const TIMESTEP = 10;
 auto const RESOLUTION = Vec2i(1280, 720);
 auto const CAPTURE_FRAME_PERIOD = 40;
+auto const REPLAY_FRAME_BUDGET = 50; // ms of ticks per display frame, when replaying
 
 IGraphicsBackend* createGraphicsBackend(Vec2i resolution);
 IRenderer* createRenderer(IGraphicsBackend* backend);
@@ -53,15 +59,26 @@ class App : View, public IApp
 {
 public:
   App(Span<char*> args)
-    : m_args({ args.data, args.data + args.len })
   {
-    m_graphicsBackend.reset(createGraphicsBackend(RESOLUTION));
-    m_renderer.reset(createRenderer(m_graphicsBackend.get()));
-    m_audio.reset(createAudio());
-    m_audioBackend.reset(createAudioBackend(m_audio.get()));
-    m_input.reset(createUserInput());
-
-    m_scene.reset(createGame(this, m_args));
+    m_startupTime = GetSteadyClockUs();
+
+    parseArgs(args);
+
+    measure("graphics backend", [&] () { m_graphicsBackend.reset(createGraphicsBackend(RESOLUTION)); });
+    m_stateFilter = createStateFilter(m_graphicsBackend.get());
+    measure("renderer", [&] () { m_renderer.reset(createRenderer(m_stateFilter.get())); });
+    m_renderer->setLodBias(m_lodBias);
+    m_renderer->setTextureBudget(m_textureBudget);
+    m_renderer->setText(TextId::ConfirmExit, "QUIT? [Y/N]");
+    m_renderer->setText(TextId::Pause, "PAUSE");
+    m_renderer->setText(TextId::SlowMotion, "SLOW-MOTION MODE");
+    m_renderer->setText(TextId::TextBox, "");
+    measure("audio", [&] () { m_audio.reset(createAudio()); });
+    measure("audio backend", [&] () { m_audioBackend.reset(createAudioBackend(m_audio.get())); });
+    measure("input", [&] () { m_input.reset(createUserInput()); });
+
+    srand(m_recording.seed);
+    measure("game", [&] () { m_scene.reset(createGame(this, m_args)); });
 
     m_graphicsBackend->enableGrab(m_doGrab);
 
@@ -91,10 +108,75 @@ public:
       tickOneDisplayFrame(now);
     }
 
+    if(m_running == AppState::Exit && !m_recordPath.empty())
+      saveRecording();
+
     return m_running != AppState::Exit;
   }
 
 private:
+  // App options are removed, the remaining ones are passed to the game.
+  //  --record <file>: records the input of the session
+  //  --replay <file>: replays a recorded session, as fast as possible
+  //  --lod-bias <pixels>: see IRenderer::setLodBias
+  //  --texture-budget <megabytes>: see IRenderer::setTextureBudget
+  void parseArgs(Span<char*> args)
+  {
+    for(int i = 0; i < args.len; ++i)
+    {
+      const std::string arg = args[i];
+
+      if(arg == "--record" && i + 1 < args.len)
+        m_recordPath = args[++i];
+      else if(arg == "--replay" && i + 1 < args.len)
+        m_replayPath = args[++i];
+      else if(arg == "--lod-bias" && i + 1 < args.len)
+        m_lodBias = atof(args[++i]);
+      else if(arg == "--texture-budget" && i + 1 < args.len)
+        m_textureBudget = atoi(args[++i]);
+      else
+        m_args.push_back(arg);
+    }
+
+    if(!m_replayPath.empty())
+    {
+      m_recording = deserializeRecording(File::read(m_replayPath));
+      m_args = m_recording.args;
+      logMsg("[replay] '%s': %d ticks", m_replayPath.c_str(), (int)m_recording.ticks.size());
+    }
+    else
+    {
+      m_recording.seed = (uint32_t)GetSteadyClockUs();
+      m_recording.args = m_args;
+    }
+  }
+
+  void saveRecording()
+  {
+    m_recording.finalState = computeStateDigest(m_actors);
+
+    auto const data = serializeRecording(m_recording);
+    File::write(m_recordPath, { (const uint8_t*)data.data(), (int)data.size() });
+    logMsg("[record] saved %d ticks to '%s' (%d bytes)", (int)m_recording.ticks.size(), m_recordPath.c_str(), (int)data.size());
+
+    m_recordPath.clear();
+  }
+
+  void finishReplay()
+  {
+    m_replayPath.clear();
+    m_running = AppState::Exit;
+
+    reportTickTimings("replay", std::move(m_tickTimings));
+
+    auto const digest = computeStateDigest(m_actors);
+
+    if(digest == m_recording.finalState)
+      logMsg("[replay] final state OK (%08X)", digest);
+    else
+      logMsg("[replay] final state MISMATCH: expected %08X, got %08X", m_recording.finalState, digest);
+  }
+
   void tickOneDisplayFrame(int now)
   {
     const auto timeStep = m_slowMotion ? TIMESTEP * 10 : TIMESTEP;
@@ -107,13 +189,34 @@ private:
       ++ticksPerFrame;
     }
 
-    for(int k = 0; k < ticksPerFrame; ++k)
+    auto canTick = [&] () { return !m_paused && m_running == AppState::Running; };
+
+    if(!m_replayPath.empty())
     {
-      if(!m_paused && m_running == AppState::Running)
+      // replays don't wait for the clock: they tick until the frame budget is used up,
+      // so the display frame rate (e.g vsync) doesn't slow them down
+      auto const deadline = GetSteadyClockMs() + REPLAY_FRAME_BUDGET;
+      ticksPerFrame = 0;
+
+      while(canTick() && m_replayPos < (int)m_recording.ticks.size() && GetSteadyClockMs() < deadline)
       {
         tickGameplay();
         m_tps.tick(now);
-        ggTps = m_tps.slope();
+        ++ticksPerFrame;
+      }
+
+      ggTps = m_tps.slope();
+    }
+    else
+    {
+      for(int k = 0; k < ticksPerFrame; ++k)
+      {
+        if(canTick())
+        {
+          tickGameplay();
+          m_tps.tick(now);
+          ggTps = m_tps.slope();
+        }
       }
     }
 
@@ -127,12 +230,68 @@ private:
 
     m_fps.tick(now);
     ggFps = m_fps.slope();
+
+    if(!m_startupReportDone)
+      printStartupReport();
+
+    if(!m_replayPath.empty() && m_replayPos == (int)m_recording.ticks.size())
+      finishReplay();
+  }
+
+  // Time-to-first-frame, broken down by subsystem and by resource
+  void printStartupReport()
+  {
+    m_startupReportDone = true;
+
+    auto const totalTime = (GetSteadyClockUs() - m_startupTime) / 1000.0f;
+
+    auto byDecreasingTime = [] (const StartupTiming& a, const StartupTiming& b)
+      {
+        return a.ms > b.ms;
+      };
+
+    std::sort(m_startupTimings.begin(), m_startupTimings.end(), byDecreasingTime);
+
+    logMsg("[app] time to first frame: %.1f ms", totalTime);
+
+    for(auto& timing : m_startupTimings)
+      logMsg("[app]   %7.1f ms: %s", timing.ms, timing.what.c_str());
+
+    m_startupTimings.clear();
+  }
+
+  // Runs 'func', and accounts for the time it took.
+  template<typename Lambda>
+  void measure(std::string what, Lambda func)
+  {
+    auto const t0 = GetSteadyClockUs();
+    func();
+    auto const t1 = GetSteadyClockUs();
+
+    auto const ms = (t1 - t0) / 1000.0f;
+
+    if(m_startupReportDone)
+      logMsg("[app] %s: %.1f ms", what.c_str(), ms);
+    else
+      m_startupTimings.push_back({ what, ms });
   }
 
   void tickGameplay()
   {
     m_control.debug = m_debugMode;
 
+    if(!m_replayPath.empty())
+    {
+      if(m_replayPos >= (int)m_recording.ticks.size())
+        return;
+
+      m_control = m_recording.ticks[m_replayPos++];
+    }
+    else if(!m_recordPath.empty())
+    {
+      m_recording.ticks.push_back(m_control);
+    }
+
     auto const t0 = GetSteadyClockUs();
 
     auto next = m_scene->tick(m_control);
@@ -144,6 +303,9 @@ private:
 
     auto const t1 = GetSteadyClockUs();
     ggTickDuration = (t1 - t0) / 1000.0f;
+
+    if(!m_replayPath.empty())
+      m_tickTimings.push_back(t1 - t0);
   }
 
   void registerUserInputActions()
@@ -184,7 +346,7 @@ private:
     m_input->listenToKey(Key::R, [&] (bool isDown) { m_control.restart = isDown; });
 
     // Debug keys
-    m_input->listenToKey(Key::F2, [&] (bool isDown) { if(isDown) m_scene.reset(createGame(this, m_args)); });
+    m_input->listenToKey(Key::F2, [&] (bool isDown) { if(isDown) restartGame(); });
     m_input->listenToKey(Key::Tab, [&] (bool isDown) { if(isDown) m_slowMotion = !m_slowMotion; });
     m_input->listenToKey(Key::ScrollLock, [&] (bool isDown) { if(isDown) toggleDebug(); });
     m_input->listenToKey(Key::Pause, [&] (bool isDown) { if(isDown){ playSound(0); togglePause(); } });
@@ -196,6 +358,8 @@ private:
 
     for(auto& actor : m_actors)
     {
+      useResource(ResourceType::Model, actor.model);
+
       auto where = Rect3f(actor.pos, actor.scale);
       m_renderer->drawActor(where, actor.orientation, actor.model, actor.effect == Effect::Blinking);
     }
@@ -211,25 +375,18 @@ private:
     }
 
     if(m_running == AppState::ConfirmExit)
-      m_renderer->drawText(Vec2f(0, 0), "QUIT? [Y/N]");
+      m_renderer->drawText(Vec2f(0, 0), TextId::ConfirmExit);
     else if(m_paused)
-      m_renderer->drawText(Vec2f(0, 0), "PAUSE");
+      m_renderer->drawText(Vec2f(0, 0), TextId::Pause);
     else if(m_slowMotion)
-      m_renderer->drawText(Vec2f(0, 0), "SLOW-MOTION MODE");
+      m_renderer->drawText(Vec2f(0, 0), TextId::SlowMotion);
 
     if(m_debugMode)
-    {
-      for(int i = 0; i < getStatCount(); ++i)
-      {
-        auto stat = getStat(i);
-        char buf[256];
-        m_renderer->drawText(Vec2f(0, 4 - i * 0.5), format(buf, "%s: %.2f", stat.name, stat.val));
-      }
-    }
+      drawStats();
 
     if(m_textboxDelay > 0)
     {
-      m_renderer->drawText(Vec2f(0, 2), m_textbox);
+      m_renderer->drawText(Vec2f(0, 2), TextId::TextBox);
       m_textboxDelay--;
     }
 
@@ -238,6 +395,42 @@ private:
     m_recorder.captureDisplayFrameIfNeeded(m_graphicsBackend.get(), RESOLUTION);
   }
 
+  // The labels are retained texts, the values change too often:
+  // they all go to the same batch of quads.
+  // The lines are aligned on the end of their labels.
+  void drawStats()
+  {
+    for(int i = 0; i < getStatCount(); ++i)
+    {
+      auto stat = getStat(i);
+      char buf[256];
+
+      if(i >= (int)m_statLabelWidths.size())
+      {
+        auto const label = format(buf, "%s: ", stat.name);
+        m_renderer->setText(TextId::FirstStat + i, label);
+        m_statLabelWidths.push_back(label.len * IRenderer::TextCharWidth);
+      }
+
+      auto const y = 4 - i * 0.5f;
+      auto const value = format(buf, "%.2f", stat.val);
+
+      m_renderer->drawText(Vec2f(-m_statLabelWidths[i] / 2, y), TextId::FirstStat + i);
+      m_renderer->drawText(Vec2f(value.len * IRenderer::TextCharWidth / 2, y), value);
+    }
+  }
+
+  void restartGame()
+  {
+    if(!m_recordPath.empty() || !m_replayPath.empty())
+    {
+      logMsg("Can't restart the game while recording or replaying");
+      return;
+    }
+
+    m_scene.reset(createGame(this, m_args));
+  }
+
   void onQuit()
   {
     if(m_running == AppState::ConfirmExit)
@@ -329,22 +522,95 @@ private:
     m_graphicsBackend->setCaption(gameTitle);
   }
 
+  void declare(Resource res) override
+  {
+    auto& entry = m_resources[{ res.type, res.id }];
+    const std::string path(res.path.data, res.path.len);
+
+    if(entry.loaded && entry.path != path)
+      unloadResource(entry);
+
+    entry.type = res.type;
+    entry.id = res.id;
+    entry.path = path;
+  }
+
   void preload(Resource res) override
   {
-    switch(res.type)
+    declare(res);
+    useResource(res.type, res.id);
+  }
+
+  void setModelPvs(int modelId, std::shared_ptr<const Pvs> pvs) override
+  {
+    m_renderer->setModelPvs(modelId, std::move(pvs));
+  }
+
+  void evictUnusedResources() override
+  {
+    for(auto& pair : m_resources)
+    {
+      auto& entry = pair.second;
+
+      if(entry.loaded && entry.lastUsed < m_resourceEpoch)
+        unloadResource(entry);
+    }
+
+    ++m_resourceEpoch;
+  }
+
+  // Loads the resource if needed, and protects it from the next eviction
+  void useResource(ResourceType type, int id)
+  {
+    auto i = m_resources.find({ type, id });
+
+    if(i == m_resources.end())
+      return;
+
+    auto& entry = i->second;
+    entry.lastUsed = m_resourceEpoch;
+
+    if(!entry.loaded)
+      loadResource(entry);
+  }
+
+  struct ResourceEntry;
+
+  void loadResource(ResourceEntry& entry)
+  {
+    switch(entry.type)
     {
     case ResourceType::Sound:
-      m_audio->loadSound(res.id, res.path);
+      measure(entry.path, [&] () { m_audio->loadSound(entry.id, entry.path); });
       break;
     case ResourceType::Model:
-      m_renderer->loadModel(res.id, res.path);
+      // Only queued: the mesh loads in the background, after the first frame.
+      // The renderer reports its load time once it's done.
+      m_renderer->loadModel(entry.id, entry.path);
       break;
     }
+
+    entry.loaded = true;
+  }
+
+  void unloadResource(ResourceEntry& entry)
+  {
+    switch(entry.type)
+    {
+    case ResourceType::Sound:
+      m_audio->unloadSound(entry.id);
+      break;
+    case ResourceType::Model:
+      m_renderer->unloadModel(entry.id);
+      break;
+    }
+
+    entry.loaded = false;
   }
 
   void textBox(String msg) override
   {
-    m_textbox.assign(msg.data, msg.len);
+    m_renderer->setText(TextId::TextBox, msg);
     m_textboxDelay = 60 * 2;
   }
 
@@ -380,6 +646,8 @@ private:
 
   void playSound(int soundId, const Vec3f* position = nullptr) override
   {
+    useResource(ResourceType::Sound, soundId);
+
     auto voiceId = m_audio->createVoice();
 
     if(position)
@@ -423,11 +691,23 @@ private:
   AppState m_running = AppState::Running;
   int m_fixedDisplayFramePeriod = 0;
 
+  struct StartupTiming
+  {
+    std::string what;
+    float ms;
+  };
+
+  int64_t m_startupTime;
+  bool m_startupReportDone = false;
+  std::vector<StartupTiming> m_startupTimings;
+
   VideoCapture m_recorder;
 
   bool m_debugMode = false;
   bool m_enableHdr = true;
   bool m_enableFsaa = false;
+  float m_lodBias = 1;
+  int m_textureBudget = 256; // megabytes
 
   int m_lastTime;
   int m_lastDisplayFrameTime;
@@ -435,6 +715,13 @@ private:
   RateCounter m_tps;
   Control m_control {};
   std::vector<std::string> m_args;
+
+  // input recording/replay
+  InputRecording m_recording;
+  std::string m_recordPath;
+  std::string m_replayPath;
+  int m_replayPos = 0;
+  std::vector<int64_t> m_tickTimings;
   bool m_slowMotion = false;
   bool m_fullscreen = false;
   bool m_paused = false;
@@ -442,13 +729,39 @@ private:
   std::unique_ptr<MixableAudio> m_audio;
   std::unique_ptr<IAudioBackend> m_audioBackend;
   std::unique_ptr<IGraphicsBackend> m_graphicsBackend;
+  std::unique_ptr<IStateFilter> m_stateFilter; // between the renderer and the graphics backend
   std::unique_ptr<IRenderer> m_renderer;
   std::vector<Actor> m_actors;
   std::vector<LightActor> m_lightActors;
   std::unique_ptr<UserInput> m_input;
 
-  std::string m_textbox;
   int m_textboxDelay = 0;
+  std::vector<float> m_statLabelWidths; // one per stat label already created, see 'drawStats'
+
+  // see IRenderer::setText
+  struct TextId
+  {
+    enum
+    {
+      ConfirmExit,
+      Pause,
+      SlowMotion,
+      TextBox,
+      FirstStat,
+    };
+  };
+
+  struct ResourceEntry
+  {
+    ResourceType type;
+    int id;
+    std::string path;
+    bool loaded = false;
+    int lastUsed = 0; // value of 'm_resourceEpoch' at the last use
+  };
+
+  std::map<std::pair<ResourceType, int>, ResourceEntry> m_resources;
+  int m_resourceEpoch = 0;
 
   std::unique_ptr<Scene> m_scene;
 };
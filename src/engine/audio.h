@@ -16,6 +16,7 @@ struct Audio
   virtual ~Audio() = default;
 
   virtual void loadSound(int soundId, String path) = 0;
+  virtual void unloadSound(int soundId) = 0;
 
   virtual VoiceId createVoice() = 0;
   virtual void releaseVoice(VoiceId id, bool autonomous = false) = 0;
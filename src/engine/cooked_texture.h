@@ -0,0 +1,45 @@
+// Copyright (C) 2026 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+// Textures, as cooked by the mesh cooker ('.tex' files).
+// Texture arrays of RGBA8 texels, with the full mip chain, the biggest level first.
+// The rows of each layer are stored bottom-up, as glTexImage3D expects them.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "base/geom.h"
+#include "base/span.h"
+
+struct CookedTexture
+{
+  Vec2i dim; // of the level 0
+  int layerCount;
+  int levelCount;
+  Span<const uint8_t> texels; // level by level, all the layers of a level one after another
+};
+
+int getMipLevelCount(Vec2i dim);
+Vec2i getMipLevelSize(Vec2i dim, int level);
+
+// RGBA8, top row first
+struct TextureImage
+{
+  Vec2i dim;
+  std::vector<uint8_t> pixels;
+};
+
+TextureImage decodeTextureImage(Span<const uint8_t> pngData);
+
+// Flips the layers and generates their mip levels.
+// All the layers must have the same size.
+// Returns the contents of the '.tex' file.
+std::vector<uint8_t> cookTexture(Span<const TextureImage> layers);
+
+// The result points inside 'data'
+CookedTexture parseCookedTexture(Span<const uint8_t> data);
@@ -14,6 +14,7 @@
 #include "base/geom.h"
 #include "base/string.h"
 
+struct CookedTexture;
 struct PictureView;
 
 struct IScreenSizeListener
@@ -31,6 +32,9 @@ struct ITexture
 {
   virtual ~ITexture() = default;
   virtual void upload(PictureView pic) = 0;
+  // Uploads the layers and mip levels as they are, as a texture array.
+  // The levels finer than 'firstLevel' are left out, and their memory released.
+  virtual void uploadMipChain(CookedTexture const& tex, int firstLevel = 0) = 0;
   virtual void setNoRepeat() = 0;
   virtual void bind(int unit) = 0;
 };
@@ -39,6 +43,16 @@ struct IVertexBuffer
 {
   virtual ~IVertexBuffer() = default;
   virtual void upload(const void* data, size_t len) = 0;
+
+  // Overwrites a part of the storage allocated by 'upload', leaving the rest as it is
+  virtual void update(size_t offset, const void* data, size_t len) = 0;
+};
+
+struct IIndexBuffer
+{
+  virtual ~IIndexBuffer() = default;
+  // 'indexSize' is 2 or 4 bytes
+  virtual void upload(const void* data, int indexCount, int indexSize) = 0;
 };
 
 struct IFrameBuffer
@@ -47,6 +61,14 @@ struct IFrameBuffer
   virtual ITexture* getColorTexture() = 0;
 };
 
+// Normalized formats are read as floats in [0;1] (unsigned) or [-1;1] (signed)
+enum class AttributeFormat
+{
+  Float,
+  Unorm16,
+  Snorm16,
+};
+
 struct IGraphicsBackend
 {
   virtual ~IGraphicsBackend() = default;
@@ -59,6 +81,7 @@ struct IGraphicsBackend
 
   virtual std::unique_ptr<ITexture> createTexture() = 0;
   virtual std::unique_ptr<IVertexBuffer> createVertexBuffer(bool dynamic = false) = 0;
+  virtual std::unique_ptr<IIndexBuffer> createIndexBuffer() = 0;
   virtual std::unique_ptr<IFrameBuffer> createFrameBuffer(Vec2i resolution, bool depth = true) = 0;
   virtual std::unique_ptr<IGpuProgram> createGpuProgram(String name, bool zTest) = 0;
 
@@ -68,9 +91,19 @@ struct IGraphicsBackend
   virtual void setRenderTarget(IFrameBuffer* fb) = 0;
   virtual void useGpuProgram(IGpuProgram* program) = 0;
   virtual void useVertexBuffer(IVertexBuffer* vb) = 0;
-  virtual void enableVertexAttribute(int id, int dim, int stride, int offset) = 0;
-  virtual void setUniformBlock(void* ptr, size_t size) = 0;
-  virtual void draw(int vertexCount) = 0;
+  virtual void useIndexBuffer(IIndexBuffer* ib) = 0;
+  virtual void enableVertexAttribute(int id, int dim, int stride, int offset, AttributeFormat format = AttributeFormat::Float) = 0;
+  // 'binding' must match the binding of the uniform block in the shader
+  virtual void setUniformBlock(void* ptr, size_t size, int binding = 0) = 0;
+  virtual void draw(int vertexCount, int firstVertex = 0) = 0;
+
+  // instancing: an instance attribute advances once per instance, instead of once per vertex.
+  // Disabled using 'enableVertexAttribute(id, 0, 0, 0)'.
+  virtual void enableInstanceAttribute(int id, int dim, int stride, int offset) = 0;
+  virtual void drawInstanced(int vertexCount, int instanceCount, int firstVertex = 0) = 0;
+
+  // same, reading the vertices through the current index buffer
+  virtual void drawIndexedInstanced(int indexCount, int instanceCount, int firstIndex = 0) = 0;
   virtual void clear() = 0;
   virtual void swap() = 0;
 };
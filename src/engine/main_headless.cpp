@@ -0,0 +1,350 @@
+// Copyright (C) 2026 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+// Entry point for the headless runner.
+// Runs the game logic without any display, audio or input device:
+// each level is simulated for a fixed number of ticks, as fast as possible,
+// using a scripted input. Used for gameplay/physics throughput measurements.
+// Can also replay an input recording (see replay.h) without rendering.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib> // atoi, srand
+#include <cstring> // strcmp
+#include <exception>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/error.h"
+#include "base/scene.h"
+#include "base/span.h"
+#include "base/view.h"
+#include "misc/file.h"
+#include "misc/time.h"
+
+#include "replay.h"
+
+// Implemented by the game-specific part
+Scene* createGame(View* view, Span<const std::string> argv);
+
+namespace
+{
+// Swallows everything, only counts what it receives
+struct NullView : View
+{
+  void setTitle(String) override {}
+  void declare(Resource) override {}
+  void preload(Resource) override {}
+  void evictUnusedResources() override {}
+  void setModelPvs(int, std::shared_ptr<const Pvs>) override {}
+  void textBox(String) override {}
+  void playMusic(int) override {}
+  void stopMusic() override {}
+  void playSound(int, const Vec3f*) override { ++soundCount; }
+  void setCameraPos(Vec3f, Quaternion) override {}
+  void setAmbientLight(float) override {}
+  void sendLight(LightActor const&) override { ++lightCount; }
+  void sendActor(Actor const& actor) override { ++actorCount; actors.push_back(actor); }
+
+  std::vector<Actor> actors; // sent during the last draw
+  int64_t soundCount = 0;
+  int64_t lightCount = 0;
+  int64_t actorCount = 0;
+};
+
+// One line of input script: 'ticks' times the same control
+struct ScriptStep
+{
+  int ticks;
+  Control control;
+};
+
+// Script format: one step per line:
+// <ticks> [forward|backward|left|right|use|fire|jump|dash|restart|look=<horz>,<vert>]...
+// e.g "20 forward jump look=0.01,0"
+const char DefaultScript[] =
+  "100 forward\n"
+  "30 forward jump\n"
+  "60 forward look=0.02,0\n"
+  "50 left\n"
+  "20 jump\n"
+  "80 forward use\n"
+  "40 backward look=-0.03,0.005\n"
+  "50 right fire\n"
+  "60 forward dash look=0,-0.005\n";
+
+std::vector<ScriptStep> parseScript(std::string const& text)
+{
+  std::vector<ScriptStep> r;
+
+  size_t pos = 0;
+
+  while(pos < text.size())
+  {
+    auto eol = text.find('\n', pos);
+
+    if(eol == text.npos)
+      eol = text.size();
+
+    const auto line = text.substr(pos, eol - pos);
+    pos = eol + 1;
+
+    ScriptStep step {};
+    int n = 0;
+
+    if(sscanf(line.c_str(), "%d%n", &step.ticks, &n) != 1)
+      continue; // empty line, or comment
+
+    char word[64];
+    const char* p = line.c_str() + n;
+
+    while(sscanf(p, "%63s%n", word, &n) == 1)
+    {
+      p += n;
+
+      auto& c = step.control;
+
+      if(!strcmp(word, "forward"))
+        c.forward = true;
+      else if(!strcmp(word, "backward"))
+        c.backward = true;
+      else if(!strcmp(word, "left"))
+        c.left = true;
+      else if(!strcmp(word, "right"))
+        c.right = true;
+      else if(!strcmp(word, "use"))
+        c.use = true;
+      else if(!strcmp(word, "fire"))
+        c.fire = true;
+      else if(!strcmp(word, "jump"))
+        c.jump = true;
+      else if(!strcmp(word, "dash"))
+        c.dash = true;
+      else if(!strcmp(word, "restart"))
+        c.restart = true;
+      else if(sscanf(word, "look=%f,%f", &c.look_horz, &c.look_vert) != 2)
+        throw Error("Invalid input script command");
+    }
+
+    if(step.ticks > 0)
+      r.push_back(step);
+  }
+
+  if(r.empty())
+    throw Error("Empty input script");
+
+  return r;
+}
+
+struct LevelResult
+{
+  int ticks = 0;
+  int64_t totalUs = 0;
+  int64_t tickUs = 0;
+  int64_t drawUs = 0;
+  int64_t maxTickUs = 0;
+};
+
+LevelResult runLevel(int level, int tickCount, std::vector<ScriptStep> const& script, NullView& view)
+{
+  const std::vector<std::string> args = { std::to_string(level) };
+  std::unique_ptr<Scene> scene(createGame(&view, args));
+
+  LevelResult r;
+
+  int stepIndex = 0;
+  int stepTicks = 0;
+
+  const auto t0 = GetSteadyClockUs();
+
+  for(int i = 0; i < tickCount; ++i)
+  {
+    if(stepTicks >= script[stepIndex].ticks)
+    {
+      stepTicks = 0;
+      stepIndex = (stepIndex + 1) % (int)script.size();
+    }
+
+    ++stepTicks;
+
+    const auto tickStart = GetSteadyClockUs();
+
+    auto next = scene->tick(script[stepIndex].control);
+
+    if(next != scene.get())
+      scene.reset(next);
+
+    const auto drawStart = GetSteadyClockUs();
+
+    view.actors.clear();
+    scene->draw();
+
+    const auto drawEnd = GetSteadyClockUs();
+
+    r.tickUs += drawStart - tickStart;
+    r.drawUs += drawEnd - drawStart;
+    r.maxTickUs = std::max<int64_t>(r.maxTickUs, drawStart - tickStart);
+    ++r.ticks;
+  }
+
+  r.totalUs = GetSteadyClockUs() - t0;
+
+  return r;
+}
+
+// Returns false if the final state doesn't match the recorded one
+bool runReplay(std::string path)
+{
+  const auto rec = deserializeRecording(File::read(path));
+
+  NullView view;
+
+  srand(rec.seed);
+  std::unique_ptr<Scene> scene(createGame(&view, rec.args));
+
+  std::vector<int64_t> tickUs;
+  tickUs.reserve(rec.ticks.size());
+
+  const auto t0 = GetSteadyClockUs();
+
+  for(auto& control : rec.ticks)
+  {
+    const auto tickStart = GetSteadyClockUs();
+
+    auto next = scene->tick(control);
+
+    if(next != scene.get())
+      scene.reset(next);
+
+    tickUs.push_back(GetSteadyClockUs() - tickStart);
+
+    view.actors.clear();
+    scene->draw();
+  }
+
+  const auto totalUs = GetSteadyClockUs() - t0;
+
+  printf("[headless] replay '%s': %d ticks in %.1f ms (%.0f ticks/s)\n",
+         path.c_str(),
+         (int)rec.ticks.size(),
+         totalUs / 1000.0,
+         rec.ticks.size() * 1000000.0 / std::max<int64_t>(1, totalUs));
+
+  fflush(stdout);
+  reportTickTimings("headless", std::move(tickUs));
+
+  const auto digest = computeStateDigest(view.actors);
+
+  if(digest != rec.finalState)
+  {
+    printf("[headless] final state MISMATCH: expected %08X, got %08X\n", rec.finalState, digest);
+    return false;
+  }
+
+  printf("[headless] final state OK (%08X)\n", digest);
+  return true;
+}
+
+bool levelExists(int level)
+{
+  char buf[256];
+  return File::exists(format(buf, "res/rooms/%02d/room.fbx", level));
+}
+
+int usage(const char* progName)
+{
+  fprintf(stderr, "Usage: %s [-n <ticks per level>] [-s <input script>] [levels...]\n", progName);
+  fprintf(stderr, "       %s -r <input recording>\n", progName);
+  return 1;
+}
+}
+
+int main(int argc, const char* argv[])
+{
+  try
+  {
+    int tickCount = 1000;
+    std::string scriptText = DefaultScript;
+    std::vector<int> levels;
+    std::string replayPath;
+
+    for(int i = 1; i < argc; ++i)
+    {
+      const std::string arg = argv[i];
+
+      if(arg == "-n" && i + 1 < argc)
+        tickCount = atoi(argv[++i]);
+      else if(arg == "-s" && i + 1 < argc)
+        scriptText = File::read(std::string(argv[++i]));
+      else if(arg == "-r" && i + 1 < argc)
+        replayPath = argv[++i];
+      else if(arg[0] != '-')
+        levels.push_back(atoi(arg.c_str()));
+      else
+        return usage(argv[0]);
+    }
+
+    if(tickCount <= 0)
+      return usage(argv[0]);
+
+    if(!replayPath.empty())
+      return runReplay(replayPath) ? 0 : 1;
+
+    if(levels.empty())
+    {
+      for(int level = 1; level < 100; ++level)
+        if(levelExists(level))
+          levels.push_back(level);
+    }
+
+    if(levels.empty())
+      throw Error("No level found in 'res/rooms'");
+
+    const auto script = parseScript(scriptText);
+
+    int64_t totalTicks = 0;
+    int64_t totalUs = 0;
+
+    for(auto level : levels)
+    {
+      NullView view;
+      auto const r = runLevel(level, tickCount, script, view);
+
+      printf("[headless] level %02d: %d ticks in %.1f ms (%.0f ticks/s) | tick: avg %.3f ms, max %.3f ms | draw: avg %.3f ms | %d actors/tick\n",
+             level,
+             r.ticks,
+             r.totalUs / 1000.0,
+             r.ticks * 1000000.0 / std::max<int64_t>(1, r.totalUs),
+             r.tickUs / 1000.0 / r.ticks,
+             r.maxTickUs / 1000.0,
+             r.drawUs / 1000.0 / r.ticks,
+             int(view.actorCount / r.ticks));
+
+      totalTicks += r.ticks;
+      totalUs += r.totalUs;
+    }
+
+    printf("[headless] total: %d ticks in %.1f ms (%.0f ticks/s)\n",
+           (int)totalTicks,
+           totalUs / 1000.0,
+           totalTicks * 1000000.0 / std::max<int64_t>(1, totalUs));
+
+    return 0;
+  }
+  catch(Error const& e)
+  {
+    fflush(stdout);
+    fprintf(stderr, "Fatal: %.*s\n", e.message().len, e.message().data);
+    return 1;
+  }
+  catch(std::exception const& e)
+  {
+    fflush(stdout);
+    fprintf(stderr, "Fatal: %s\n", e.what());
+    return 1;
+  }
+}
@@ -1,3 +1,4 @@
+#include <array>
 #include <map>
 #include <string.h> // memcpy
 
@@ -6,11 +7,21 @@
 #include "base/span.h"
 #include "base/util.h" // setExtension
 #include "misc/file.h" // exists
+#include "misc/pvs.h"
+#include "misc/vertex_cache.h"
 
+#include "cooked_texture.h"
 #include "rendermesh.h"
 
 namespace
 {
+// Width of the grid cells used to split the meshes into chunks, in logical units.
+// Small meshes (e.g sprites) end up in a single chunk.
+const float ChunkSize = 8;
+
+// Width of the cells used for the visibility computation, in logical units.
+const float PvsCellSize = 8;
+
 bool startsWith(std::string s, std::string prefix)
 {
   return s.substr(0, prefix.size()) == prefix;
@@ -81,6 +92,12 @@ RenderMesh convertToRenderMesh(std::vector<Mesh> const& meshes, std::vector<std:
   return r;
 }
 
+// 16-bit indices whenever possible
+int getIndexSize(SingleRenderMesh const& single)
+{
+  return single.packedVertices.size() <= 0x10000 ? 2 : 4;
+}
+
 void writeRenderMesh(std::string path, const RenderMesh& renderMesh)
 {
   std::vector<uint8_t> data;
@@ -95,16 +112,57 @@ void writeRenderMesh(std::string path, const RenderMesh& renderMesh)
   for(auto& single : renderMesh.singleMeshes)
   {
     write(&single.transparency, 1);
+    write(&single.textureArray, 4);
+    write(&single.textureLayer, 4);
+    write(&single.quantization, sizeof single.quantization);
 
-    const int num = (int)single.vertices.size();
+    const int num = (int)single.packedVertices.size();
     write(&num, 4);
 
-    for(auto& vertex : single.vertices)
+    for(auto& vertex : single.packedVertices)
       write(&vertex, sizeof vertex);
+
+    const int indexSize = getIndexSize(single);
+    write(&indexSize, 4);
+
+    const int indexCount = (int)single.indices.size();
+    write(&indexCount, 4);
+
+    for(auto index : single.indices)
+      write(&index, indexSize); // little endian
+
+    const int chunkCount = (int)single.chunks.size();
+    write(&chunkCount, 4);
+
+    for(auto& chunk : single.chunks)
+      write(&chunk, sizeof chunk);
+
+    const int lodCount = (int)single.lods.size();
+    write(&lodCount, 4);
+
+    for(auto& lod : single.lods)
+    {
+      write(&lod.error, 4);
+
+      for(auto& range : lod.chunks)
+        write(&range, sizeof range);
+    }
   }
 
   File::write(path, data);
 }
+
+TextureImage loadTextureImage(std::string inputPath, Span<const uint8_t> fallbackPng)
+{
+  if(!File::exists(inputPath))
+  {
+    fprintf(stderr, "File doesn't exist: '%s'\n", inputPath.c_str());
+    return decodeTextureImage(fallbackPng);
+  }
+
+  auto pngData = File::read(inputPath);
+  return decodeTextureImage({ (const uint8_t*)pngData.data(), (int)pngData.size() });
+}
 }
 
 int main(int argc, const char* argv[])
@@ -122,11 +180,108 @@ int main(int argc, const char* argv[])
 
     std::vector<std::string> textureFiles;
     auto renderMesh = convertToRenderMesh(scene.meshes, textureFiles);
-    writeRenderMesh(outputPathMesh, renderMesh);
 
-    int meshIndex = 0;
+    int chunkCount = 0;
+    size_t soupBytes = 0;
+
+    for(auto& single : renderMesh.singleMeshes)
+    {
+      splitIntoChunks(single, ChunkSize);
+      chunkCount += single.chunks.size();
+
+      soupBytes += single.vertices.size() * sizeof(SingleRenderMesh::Vertex);
+      weldVertices(single);
+    }
+
+    printf("%s: %d materials, %d chunks\n", outputPathMesh, (int)renderMesh.singleMeshes.size(), chunkCount);
+
+    for(int i = 0; i < (int)renderMesh.singleMeshes.size(); ++i)
+    {
+      auto& single = renderMesh.singleMeshes[i];
+      const int vertexCount = single.vertices.size();
+
+      const auto acmrBefore = computeAcmr(single.indices);
+      const auto atvrBefore = computeAtvr(single.indices, vertexCount);
+      const int triangleCount = single.indices.size() / 3;
+
+      generateLods(single);
+      optimizeTriangleOrder(single);
+
+      // the full detail LOD comes first
+      const Span<const uint32_t> fullDetail(single.indices.data(), triangleCount * 3);
+
+      printf("%s: mesh #%d: %d triangles, ACMR %.2f -> %.2f, ATVR %.2f -> %.2f\n",
+             outputPathMesh, i, triangleCount,
+             acmrBefore, computeAcmr(fullDetail),
+             atvrBefore, computeAtvr(fullDetail, vertexCount));
+
+      for(int lod = 0; lod < (int)single.lods.size(); ++lod)
+      {
+        int lodTriangles = 0;
+
+        for(auto& range : single.lods[lod].chunks)
+          lodTriangles += range.count / 3;
+
+        printf("%s: mesh #%d: LOD %d: %d triangles, error %.3f\n", outputPathMesh, i, lod + 1, lodTriangles, single.lods[lod].error);
+      }
+    }
+
+    // Meshes bigger than a chunk (i.e rooms) get a cell-to-cell visibility.
+    if(chunkCount > (int)renderMesh.singleMeshes.size())
+    {
+      std::vector<Vec3f> occluders;
+
+      for(auto& single : renderMesh.singleMeshes)
+      {
+        if(single.transparency)
+          continue;
+
+        for(auto& chunk : single.chunks)
+        {
+          for(int k = chunk.firstIndex; k < chunk.firstIndex + chunk.indexCount; ++k)
+          {
+            auto& v = single.vertices[single.indices[k]];
+            occluders.push_back(Vec3f(v.x, v.y, v.z));
+          }
+        }
+      }
+
+      auto const pvs = computePvs(occluders, PvsCellSize);
+
+      int visiblePairs = 0;
+
+      for(int from = 0; from < pvs.cellCount(); ++from)
+        for(int to = 0; to < pvs.cellCount(); ++to)
+          visiblePairs += pvs.isVisible(from, to);
+
+      printf("%s: %d PVS cells, %.1f%% visible on average\n",
+             outputPathMesh,
+             pvs.cellCount(),
+             pvs.cellCount() ? visiblePairs * 100.0 / (pvs.cellCount() * pvs.cellCount()) : 0.0);
+
+      auto const pvsData = serializePvs(pvs);
+      File::write(setExtension(outputPathMesh, "pvs"), pvsData);
+    }
+
+    packVertices(renderMesh);
+
+    size_t cookedBytes = 0;
 
     for(auto& single : renderMesh.singleMeshes)
+      cookedBytes += single.packedVertices.size() * sizeof(SingleRenderMesh::PackedVertex) + single.indices.size() * getIndexSize(single);
+
+    printf("%s: vertex data: %d -> %d bytes, indexed and packed (%.0f%%)\n",
+           outputPathMesh,
+           (int)soupBytes,
+           (int)cookedBytes,
+           soupBytes ? cookedBytes * 100.0 / soupBytes : 100.0);
+
+    // Diffuse, normal and emissive maps of each material
+    const int MapCount = 3;
+    const char* const mapNames[MapCount] = { "diffuse", "normal", "emissive" };
+    std::vector<std::array<TextureImage, MapCount>> materialMaps;
+
+    for(int meshIndex = 0; meshIndex < (int)renderMesh.singleMeshes.size(); ++meshIndex)
     {
       static uint8_t black_png[] = { 0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a, 0x00, 0x00, 0x00, 0x0d, 0x49, 0x48, 0x44, 0x52, 0x00, 0x00, 0x00, 0x08, 0x00, 0x00, 0x00, 0x08, 0x08, 0x06, 0x00, 0x00, 0x00, 0xc4, 0x0f, 0xbe, 0x8b, 0x00, 0x00, 0x00, 0x01, 0x73, 0x52, 0x47, 0x42, 0x01, 0xd9, 0xc9, 0x2c, 0x7f, 0x00, 0x00, 0x00, 0x04, 0x67, 0x41, 0x4d, 0x41, 0x00, 0x00, 0xb1, 0x8f, 0x0b, 0xfc, 0x61, 0x05, 0x00, 0x00, 0x00, 0x20, 0x63, 0x48, 0x52, 0x4d, 0x00, 0x00, 0x7a, 0x26, 0x00, 0x00, 0x80, 0x84, 0x00, 0x00, 0xfa, 0x00, 0x00, 0x00, 0x80, 0xe8, 0x00, 0x00, 0x75, 0x30, 0x00, 0x00, 0xea, 0x60, 0x00, 0x00, 0x3a, 0x98, 0x00, 0x00, 0x17, 0x70, 0x9c, 0xba, 0x51, 0x3c, 0x00, 0x00, 0x00, 0x09, 0x70, 0x48, 0x59, 0x73, 0x00, 0x00, 0x0b, 0x13, 0x00, 0x00, 0x0b, 0x13, 0x01, 0x00, 0x9a, 0x9c, 0x18, 0x00, 0x00, 0x00, 0x07, 0x74, 0x49, 0x4d, 0x45, 0x07, 0xea, 0x04, 0x06, 0x14, 0x27, 0x05, 0x1a, 0x60, 0x26, 0x1e, 0x00, 0x00, 0x00, 0x16, 0x49, 0x44, 0x41, 0x54, 0x18, 0xd3, 0x63, 0x64, 0x60, 0x60, 0xf8, 0xcf, 0x80, 0x07, 0x30, 0x31, 0x10, 0x00, 0xc3, 0x43, 0x01, 0x00, 0x0c, 0x53, 0x01, 0x0f, 0xa9, 0xf5, 0x07, 0x69, 0x00, 0x00, 0x00, 0x00, 0x49, 0x45, 0x4e, 0x44, 0xae, 0x42, 0x60, 0x82 };
       static uint8_t gray_png[] = { 0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a, 0x00, 0x00, 0x00, 0x0d, 0x49, 0x48, 0x44, 0x52, 0x00, 0x00, 0x00, 0x08, 0x00, 0x00, 0x00, 0x08, 0x08, 0x06, 0x00, 0x00, 0x00, 0xc4, 0x0f, 0xbe, 0x8b, 0x00, 0x00, 0x00, 0x16, 0x49, 0x44, 0x41, 0x54, 0x18, 0xd3, 0x63, 0x6c, 0x68, 0x68, 0xf8, 0xcf, 0x80, 0x07, 0x30, 0x31, 0x10, 0x00, 0xc3, 0x43, 0x01, 0x00, 0x95, 0x62, 0x02, 0x8f, 0x72, 0x61, 0x0a, 0x14, 0x00, 0x00, 0x00, 0x00, 0x49, 0x45, 0x4e, 0x44, 0xae, 0x42, 0x60, 0x82 };
@@ -137,63 +292,61 @@ int main(int argc, const char* argv[])
         File::write(outputPathLightmap, gray_png);
       }
 
-      {
-        if(textureFiles[meshIndex] == "")
-          textureFiles[meshIndex] = "mesh.png";
+      if(textureFiles[meshIndex] == "")
+        textureFiles[meshIndex] = "mesh.png";
 
-        ///////////////////////////////////////////////////////////////////////
-        // Diffuse map
+      std::array<TextureImage, MapCount> maps;
+      maps[0] = loadTextureImage(textureDir + "/" + textureFiles[meshIndex], gray_png);
+      maps[1] = loadTextureImage(textureDir + "/" + setExtension(textureFiles[meshIndex], "n.png"), blue_png);
+      maps[2] = loadTextureImage(textureDir + "/" + setExtension(textureFiles[meshIndex], "e.png"), black_png);
+      materialMaps.push_back(std::move(maps));
+    }
 
-        auto const inputPathDiffuse = textureDir + "/" + textureFiles[meshIndex];
-        auto const outputPathDiffuse = setExtension(outputPathMesh, std::to_string(meshIndex) + ".diffuse.png");
+    // Materials whose maps have the same sizes share texture arrays, one layer each:
+    // the renderer doesn't need to bind other textures to switch between them.
+    std::map<std::vector<int>, int> arrayIndices;
+    std::vector<std::vector<int>> arrayMaterials;
 
-        if(File::exists(inputPathDiffuse))
-        {
-          auto pngData = File::read(inputPathDiffuse);
-          File::write(outputPathDiffuse, { (uint8_t*)pngData.data(), (int)pngData.size() });
-        }
-        else
-        {
-          fprintf(stderr, "File doesn't exist: '%s'\n", inputPathDiffuse.c_str());
-          File::write(outputPathDiffuse, gray_png);
-        }
+    for(int meshIndex = 0; meshIndex < (int)renderMesh.singleMeshes.size(); ++meshIndex)
+    {
+      std::vector<int> sizes;
 
-        ///////////////////////////////////////////////////////////////////////
-        // Normal map
+      for(auto& map : materialMaps[meshIndex])
+      {
+        sizes.push_back(map.dim.x);
+        sizes.push_back(map.dim.y);
+      }
 
-        auto const inputPathNormalMap = textureDir + "/" + setExtension(textureFiles[meshIndex], "n.png");
-        auto const outputPathNormalMap = setExtension(outputPathMesh, std::to_string(meshIndex) + ".normal.png");
+      auto i = arrayIndices.find(sizes);
 
-        if(File::exists(inputPathNormalMap))
-        {
-          auto pngData = File::read(inputPathNormalMap);
-          File::write(outputPathNormalMap, { (uint8_t*)pngData.data(), (int)pngData.size() });
-        }
-        else
-        {
-          fprintf(stderr, "File doesn't exist: '%s'\n", inputPathNormalMap.c_str());
-          File::write(outputPathNormalMap, blue_png);
-        }
+      if(i == arrayIndices.end())
+      {
+        i = arrayIndices.insert({ sizes, (int)arrayMaterials.size() }).first;
+        arrayMaterials.push_back({});
+      }
 
-        ///////////////////////////////////////////////////////////////////////
-        // Emissive map
+      auto& single = renderMesh.singleMeshes[meshIndex];
+      single.textureArray = i->second;
+      single.textureLayer = arrayMaterials[i->second].size();
+      arrayMaterials[i->second].push_back(meshIndex);
+    }
 
-        auto const inputPathEmissiveMap = textureDir + "/" + setExtension(textureFiles[meshIndex], "e.png");
-        auto const outputPathEmissiveMap = setExtension(outputPathMesh, std::to_string(meshIndex) + ".emissive.png");
+    printf("%s: %d materials, %d texture arrays\n", outputPathMesh, (int)renderMesh.singleMeshes.size(), (int)arrayMaterials.size());
 
-        if(File::exists(inputPathEmissiveMap))
-        {
-          auto pngData = File::read(inputPathEmissiveMap);
-          File::write(outputPathEmissiveMap, { (uint8_t*)pngData.data(), (int)pngData.size() });
-        }
-        else
-        {
-          fprintf(stderr, "File doesn't exist: '%s'\n", inputPathEmissiveMap.c_str());
-          File::write(outputPathEmissiveMap, black_png);
-        }
-      }
+    writeRenderMesh(outputPathMesh, renderMesh);
 
-      ++meshIndex;
+    for(int array = 0; array < (int)arrayMaterials.size(); ++array)
+    {
+      for(int map = 0; map < MapCount; ++map)
+      {
+        std::vector<TextureImage> layers;
+
+        for(auto meshIndex : arrayMaterials[array])
+          layers.push_back(std::move(materialMaps[meshIndex][map]));
+
+        auto const cooked = cookTexture(layers);
+        File::write(setExtension(outputPathMesh, std::to_string(array) + "." + mapNames[map] + ".tex"), cooked);
+      }
     }
 
     return 0;
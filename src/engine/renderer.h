@@ -12,23 +12,48 @@
 #include "base/geom.h"
 #include "base/quaternion.h"
 #include "base/string.h"
+#include <memory>
+
+struct Pvs;
 
 struct IRenderer
 {
+  static constexpr float TextCharWidth = 0.25f;
+
   virtual ~IRenderer() = default;
 
   virtual void setHdr(bool enable) = 0;
   virtual void setFsaa(bool enable) = 0;
+
+  // Screen-space error tolerated when picking a mesh LOD, in pixels (default: 1).
+  // Higher values trade detail for frame time, 0 always draws the full detail.
+  virtual void setLodBias(float bias) = 0;
+
+  // Memory for the mip levels of the mesh textures, in megabytes (default: 256).
+  // The finest levels of the biggest textures get dropped first.
+  virtual void setTextureBudget(int megabytes) = 0;
+
   virtual void loadModel(int modelId, String path) = 0;
+  virtual void unloadModel(int modelId) = 0;
+
+  // Cell-to-cell visibility of a model (i.e a room), used to skip its hidden chunks.
+  // Can be null. Kept across the reloads of the model.
+  virtual void setModelPvs(int modelId, std::shared_ptr<const Pvs> pvs) = 0;
   virtual void setCamera(Vec3f pos, Quaternion dir) = 0;
   virtual void setAmbientLight(float ambientLight) = 0;
 
+  // Text drawn over several frames, e.g a HUD message.
+  // Its glyphs go to the GPU once, and again only when its content changes.
+  virtual void setText(int textId, String text) = 0;
+
   // draw functions
   virtual void beginDraw() = 0;
   virtual void endDraw() = 0;
 
   virtual void drawActor(Rect3f where, Quaternion orientation, int modelId, bool blinking) = 0;
   virtual void drawLight(Vec3f pos, Vec3f color) = 0;
+  // Centered on 'pos'. All the characters are 'TextCharWidth' wide.
   virtual void drawText(Vec2f pos, String text) = 0;
+  virtual void drawText(Vec2f pos, int textId) = 0; // one draw call, see 'setText'
 };
 
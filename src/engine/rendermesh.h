@@ -14,17 +14,28 @@
 #include "base/string.h"
 
 struct IVertexBuffer;
+struct IIndexBuffer;
 struct ITexture;
 
 struct SingleRenderMesh
 {
   // renderer stuff
   std::shared_ptr<IVertexBuffer> vb;
+  std::shared_ptr<IIndexBuffer> ib;
   std::shared_ptr<ITexture> diffuse;
   std::shared_ptr<ITexture> normal;
   std::shared_ptr<ITexture> emissive;
   bool transparency;
 
+  // The materials of a model whose textures have the same size share texture arrays.
+  // This one uses the layer 'textureLayer' of the arrays #textureArray.
+  int textureArray = 0;
+  int textureLayer = 0;
+
+  // small ids, for sorting the draw commands
+  int meshId = 0;
+  int textureSetId = 0; // same textures, same id
+
   // mesh data
   struct Vertex
   {
@@ -35,13 +46,110 @@ struct SingleRenderMesh
     float diffuse_u, diffuse_v;
   };
 
+  // full precision, only used while cooking
   std::vector<Vertex> vertices;
+
+  // Cooked vertex format, decoded by mesh.vert
+  struct PackedVertex
+  {
+    uint16_t x, y, z; // position, quantized (see Quantization)
+    uint16_t handedness; // binormal = cross(normal, tangent) if 0xFFFF, its opposite if 0
+    int16_t normal[2]; // octahedral encoding
+    int16_t tangent[2]; // octahedral encoding
+    uint16_t diffuse_u, diffuse_v; // quantized (see Quantization)
+  };
+
+  // Maps the packed positions and uvs back to model space:
+  // value = offset + scale * (packed / 65535)
+  struct Quantization
+  {
+    Vec3f positionOffset;
+    Vec3f positionScale;
+    Vec2f uvOffset;
+    Vec2f uvScale;
+  };
+
+  std::vector<PackedVertex> packedVertices;
+  Quantization quantization {};
+
+  // 3 per triangle. Empty while 'vertices' is still a triangle soup.
+  std::vector<uint32_t> indices;
+
+  // Spatial subdivision of the triangles, computed by the mesh cooker.
+  // Each chunk is a contiguous range of indices, and gets culled on its own.
+  struct Chunk
+  {
+    int firstIndex;
+    int indexCount;
+    Vec3f boundsMin; // in model space
+    Vec3f boundsMax;
+  };
+
+  std::vector<Chunk> chunks;
+
+  // Simplified versions of the chunks, coarser and coarser.
+  // They reuse the vertices of the full detail mesh.
+  struct IndexRange
+  {
+    int first;
+    int count;
+  };
+
+  struct Lod
+  {
+    float error; // largest distance of the vertices to the original surface, in model space
+    std::vector<IndexRange> chunks; // same order as 'chunks'
+  };
+
+  std::vector<Lod> lods; // not including the full detail one
+
+  IndexRange getIndexRange(int lod, int chunk) const
+  {
+    if(lod == 0)
+      return { chunks[chunk].firstIndex, chunks[chunk].indexCount };
+
+    return lods[lod - 1].chunks[chunk];
+  }
 };
 
+// Including the full detail one
+constexpr auto MaxLods = 4;
+
 struct RenderMesh
 {
   std::vector<SingleRenderMesh> singleMeshes;
 };
 
+// Falls back on 'boxModel' if the file doesn't exist
 RenderMesh loadRenderMesh(String path);
 
+// A cube of size 1, centered on the origin
+RenderMesh boxModel();
+
+// Reorders the triangles of 'mesh' so the ones lying in the same cell
+// of a 'chunkSize'-wide grid are contiguous, and fills 'mesh.chunks'.
+// The grid starts at the lowest corner of the mesh.
+// 'mesh.vertices' must be a triangle soup.
+void splitIntoChunks(SingleRenderMesh& mesh, float chunkSize);
+
+// Turns the triangle soup of 'mesh' into indexed triangles,
+// merging the bitwise identical vertices. The triangle order is kept,
+// so the chunks stay valid.
+void weldVertices(SingleRenderMesh& mesh);
+
+// Fills 'mesh.lods', each LOD having about half the triangles of the previous one.
+// 'mesh' must be indexed and not packed yet.
+void generateLods(SingleRenderMesh& mesh);
+
+// Reorders the triangles of each chunk (of each LOD) for the GPU vertex cache and for less overdraw,
+// then the vertices, in the order the triangles use them.
+// 'mesh' must be indexed and not packed yet.
+void optimizeTriangleOrder(SingleRenderMesh& mesh);
+
+// Replaces the 'vertices' of each single mesh by 'packedVertices'.
+// All the single meshes share the same quantization,
+// so the vertices they have in common stay in the same place.
+void packVertices(RenderMesh& mesh);
+
+SingleRenderMesh::Vertex unpackVertex(SingleRenderMesh::PackedVertex const& v, SingleRenderMesh::Quantization const& q);
+
@@ -0,0 +1,308 @@
+// Copyright (C) 2026 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+#include "replay.h"
+
+#include <algorithm>
+#include <cstring> // memcpy
+
+#include "base/error.h"
+#include "base/logger.h"
+#include "base/view.h"
+
+namespace
+{
+const char Magic[4] = { 'V', 'R', 'P', 'L' };
+const uint8_t Version = 1;
+
+// bit index of each Control flag, in serialized form
+enum
+{
+  Forward,
+  Backward,
+  Left,
+  Right,
+  Use,
+  Fire,
+  Jump,
+  Dash,
+  Restart,
+  Debug,
+  HasLook, // followed by 'look_horz' and 'look_vert'
+};
+
+uint16_t getFlags(Control const& c)
+{
+  uint16_t r = 0;
+  r |= c.forward << Forward;
+  r |= c.backward << Backward;
+  r |= c.left << Left;
+  r |= c.right << Right;
+  r |= c.use << Use;
+  r |= c.fire << Fire;
+  r |= c.jump << Jump;
+  r |= c.dash << Dash;
+  r |= c.restart << Restart;
+  r |= c.debug << Debug;
+  r |= (c.look_horz != 0 || c.look_vert != 0) << HasLook;
+  return r;
+}
+
+Control fromFlags(uint16_t flags)
+{
+  Control c {};
+  c.forward = flags & (1 << Forward);
+  c.backward = flags & (1 << Backward);
+  c.left = flags & (1 << Left);
+  c.right = flags & (1 << Right);
+  c.use = flags & (1 << Use);
+  c.fire = flags & (1 << Fire);
+  c.jump = flags & (1 << Jump);
+  c.dash = flags & (1 << Dash);
+  c.restart = flags & (1 << Restart);
+  c.debug = flags & (1 << Debug);
+  return c;
+}
+
+bool isSame(Control const& a, Control const& b)
+{
+  return getFlags(a) == getFlags(b) && a.look_horz == b.look_horz && a.look_vert == b.look_vert;
+}
+
+struct Writer
+{
+  std::string data;
+
+  void u8(uint8_t val) { data += (char)val; }
+  void u16(uint16_t val) { u8(val); u8(val >> 8); }
+  void u32(uint32_t val) { u16(val); u16(val >> 16); }
+
+  void f32(float val)
+  {
+    uint32_t bits;
+    memcpy(&bits, &val, sizeof bits);
+    u32(bits);
+  }
+
+  void varint(uint32_t val)
+  {
+    while(val >= 0x80)
+    {
+      u8(0x80 | (val & 0x7F));
+      val >>= 7;
+    }
+
+    u8(val);
+  }
+};
+
+struct Reader
+{
+  std::string const& data;
+  size_t pos = 0;
+
+  uint8_t u8()
+  {
+    if(pos >= data.size())
+      throw Error("Truncated input recording");
+
+    return data[pos++];
+  }
+
+  uint16_t u16() { uint16_t r = u8(); return r | (u8() << 8); }
+  uint32_t u32() { uint32_t r = u16(); return r | (u16() << 16); }
+
+  float f32()
+  {
+    auto bits = u32();
+    float r;
+    memcpy(&r, &bits, sizeof r);
+    return r;
+  }
+
+  uint32_t varint()
+  {
+    uint32_t r = 0;
+
+    for(int shift = 0; shift < 32; shift += 7)
+    {
+      auto b = u8();
+
+      // the 5th byte only holds the 4 upper bits
+      if(shift == 28 && (b & 0xF0))
+        break;
+
+      r |= uint32_t(b & 0x7F) << shift;
+
+      if(!(b & 0x80))
+        return r;
+    }
+
+    throw Error("Invalid input recording");
+  }
+};
+
+// FNV-1a
+struct Hasher
+{
+  uint32_t value = 2166136261u;
+
+  void add(const void* data, int len)
+  {
+    auto p = (const uint8_t*)data;
+
+    for(int i = 0; i < len; ++i)
+      value = (value ^ p[i]) * 16777619u;
+  }
+
+  void add(float val) { add(&val, sizeof val); }
+  void add(int val) { add(&val, sizeof val); }
+  void add(Vec3f v) { add(v.x); add(v.y); add(v.z); }
+};
+}
+
+std::string serializeRecording(InputRecording const& rec)
+{
+  Writer w;
+
+  for(auto c : Magic)
+    w.u8(c);
+
+  w.u8(Version);
+  w.u32(rec.seed);
+  w.u32(rec.finalState);
+
+  w.varint(rec.args.size());
+
+  for(auto& arg : rec.args)
+  {
+    w.varint(arg.size());
+    w.data += arg;
+  }
+
+  w.varint(rec.ticks.size());
+
+  size_t i = 0;
+
+  while(i < rec.ticks.size())
+  {
+    auto const& c = rec.ticks[i];
+
+    uint32_t count = 1;
+
+    while(i + count < rec.ticks.size() && isSame(rec.ticks[i + count], c))
+      ++count;
+
+    const auto flags = getFlags(c);
+    w.varint(count);
+    w.u16(flags);
+
+    if(flags & (1 << HasLook))
+    {
+      w.f32(c.look_horz);
+      w.f32(c.look_vert);
+    }
+
+    i += count;
+  }
+
+  return w.data;
+}
+
+InputRecording deserializeRecording(std::string const& data)
+{
+  Reader r { data };
+
+  for(auto c : Magic)
+    if(r.u8() != (uint8_t)c)
+      throw Error("Not an input recording");
+
+  if(r.u8() != Version)
+    throw Error("Unsupported input recording version");
+
+  InputRecording rec;
+  rec.seed = r.u32();
+  rec.finalState = r.u32();
+
+  rec.args.resize(r.varint());
+
+  for(auto& arg : rec.args)
+  {
+    arg.resize(r.varint());
+
+    for(auto& c : arg)
+      c = r.u8();
+  }
+
+  const auto tickCount = r.varint();
+
+  while(rec.ticks.size() < tickCount)
+  {
+    const auto count = r.varint();
+    const auto flags = r.u16();
+
+    auto c = fromFlags(flags);
+
+    if(flags & (1 << HasLook))
+    {
+      c.look_horz = r.f32();
+      c.look_vert = r.f32();
+    }
+
+    if(count == 0 || rec.ticks.size() + count > tickCount)
+      throw Error("Invalid input recording");
+
+    rec.ticks.insert(rec.ticks.end(), count, c);
+  }
+
+  return rec;
+}
+
+uint32_t computeStateDigest(Span<const Actor> actors)
+{
+  Hasher h;
+
+  for(auto& actor : actors)
+  {
+    h.add(actor.pos);
+    h.add(actor.orientation.v);
+    h.add(actor.orientation.s);
+    h.add(actor.model);
+    h.add(actor.action);
+    h.add(actor.scale);
+    h.add((int)actor.effect);
+  }
+
+  return h.value;
+}
+
+void reportTickTimings(const char* caption, std::vector<int64_t> tickUs)
+{
+  if(tickUs.empty())
+    return;
+
+  std::sort(tickUs.begin(), tickUs.end());
+
+  int64_t total = 0;
+
+  for(auto t : tickUs)
+    total += t;
+
+  auto percentile = [&] (int p)
+    {
+      return tickUs[(tickUs.size() - 1) * p / 100] / 1000.0;
+    };
+
+  logMsg("[%s] %d ticks: avg %.3f ms | min %.3f | p50 %.3f | p90 %.3f | p99 %.3f | max %.3f",
+         caption,
+         (int)tickUs.size(),
+         total / 1000.0 / tickUs.size(),
+         tickUs.front() / 1000.0,
+         percentile(50),
+         percentile(90),
+         percentile(99),
+         tickUs.back() / 1000.0);
+}
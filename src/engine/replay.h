@@ -0,0 +1,37 @@
+// Copyright (C) 2026 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+// Input recording, for deterministic replays of a play session.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "base/scene.h"
+#include "base/span.h"
+
+struct Actor;
+
+struct InputRecording
+{
+  uint32_t seed = 0; // passed to srand() before the game gets created
+  std::vector<std::string> args; // game arguments (e.g the starting level)
+  std::vector<Control> ticks; // one entry per gameplay tick
+  uint32_t finalState = 0; // state digest after the last tick
+};
+
+// Compact binary format: runs of identical controls.
+std::string serializeRecording(InputRecording const& rec);
+InputRecording deserializeRecording(std::string const& data);
+
+// Digest of what the game sent to the view during one frame.
+// Two replays of the same recording must give the same digest.
+uint32_t computeStateDigest(Span<const Actor> actors);
+
+// Logs the distribution of the tick durations (min, median, percentiles, max)
+void reportTickTimings(const char* caption, std::vector<int64_t> tickUs);
@@ -0,0 +1,28 @@
+// Copyright (C) 2026 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+// Redundant state change elimination.
+// Sits between the renderer and any graphics backend, and drops the calls
+// that would set a state which is already the current one:
+// program, vertex/index buffers, vertex attributes and texture bindings.
+
+#pragma once
+
+#include <memory>
+
+#include "graphics_backend.h"
+
+struct IStateFilter : IGraphicsBackend
+{
+  // state change calls received since the creation of the filter
+  virtual int getIssuedCount() const = 0;
+  virtual int getSkippedCount() const = 0;
+};
+
+// Implemented in the render subsystem.
+// The objects created through the filter must not outlive it,
+// and 'backend' must outlive the filter.
+std::unique_ptr<IStateFilter> createStateFilter(IGraphicsBackend* backend);
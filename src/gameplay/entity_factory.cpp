@@ -8,31 +8,59 @@
 
 #include "entity.h"
 #include "entity_factory.h"
-#include <map>
 #include <stdexcept>
+#include <unordered_map>
+#include <vector>
 
 namespace
 {
-std::map<std::string, CreationFunc>& g_registry()
+struct Registry
 {
-  static std::map<std::string, CreationFunc> registry;
+  std::unordered_map<std::string, EntityType> types;
+  std::vector<CreationFunc> funcs; // indexed by EntityType
+};
+
+Registry& g_registry()
+{
+  static Registry registry;
   return registry;
 }
 }
 
 int registerEntity(std::string type, CreationFunc func)
 {
-  g_registry()[type] = func;
+  auto& registry = g_registry();
+  auto i = registry.types.find(type);
+
+  if(i != registry.types.end())
+  {
+    registry.funcs[i->second] = func;
+  }
+  else
+  {
+    registry.types[type] = (EntityType)registry.funcs.size();
+    registry.funcs.push_back(func);
+  }
+
   return 0; // ignored
 }
 
-std::unique_ptr<Entity> createEntity(std::string name, IEntityConfig* args)
+EntityType findEntityType(std::string name)
 {
-  auto i_func = g_registry().find(name);
+  auto i = g_registry().types.find(name);
 
-  if(i_func == g_registry().end())
+  if(i == g_registry().types.end())
     throw std::runtime_error("unknown entity type: '" + name + "'");
 
-  return (*i_func).second(args);
+  return i->second;
 }
 
+std::unique_ptr<Entity> createEntity(EntityType type, IEntityConfig* args)
+{
+  return g_registry().funcs.at(type)(args);
+}
+
+std::unique_ptr<Entity> createEntity(std::string name, IEntityConfig* args)
+{
+  return createEntity(findEntityType(name), args);
+}
@@ -13,13 +13,22 @@ struct Entity;
 
 struct IEntityConfig
 {
-  virtual std::string getString(const char* varName, std::string defaultValue = "") = 0;
+  // returns either the stored value, or 'defaultValue' itself:
+  // copy the result if the default is a temporary.
+  virtual const std::string& getString(const char* varName, const std::string& defaultValue = "") = 0;
   virtual int getInt(const char* varName, int defaultValue = 0) = 0;
 };
 
+// Interned entity type name, resolved once (e.g at room loading)
+using EntityType = int;
+
+// throws if the type name is unknown
+EntityType findEntityType(std::string name);
+
 // e.g:
 // createEntity("spider");
-// createEntity("door(4)");
+// createEntity(findEntityType("door"));
+std::unique_ptr<Entity> createEntity(EntityType type, IEntityConfig* config);
 std::unique_ptr<Entity> createEntity(std::string name, IEntityConfig* config);
 
 using CreationFunc = std::unique_ptr<Entity>(*)(IEntityConfig* args);
@@ -8,6 +8,7 @@
 
 #include "base/span.h"
 #include "base/view.h"
+#include "sounds.h" // SND_PAUSE
 #include "state_machine.h"
 #include <string>
 
@@ -17,8 +18,15 @@ Scene* createGame(View* view, Span<const std::string> args)
 {
   view->setTitle("Voiid");
 
+  // resources get loaded on first use, except the UI sound:
+  // it gets played from the splash screen ticks.
   for(auto res : AllResources)
-    view->preload(res);
+  {
+    if(res.type == ResourceType::Sound && res.id == SND_PAUSE)
+      view->preload(res);
+    else
+      view->declare(res);
+  }
 
   if(args.len == 1)
   {
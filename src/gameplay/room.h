@@ -9,22 +9,32 @@
 #pragma once
 
 #include "base/geom.h"
-#include <map>
 #include <string>
 #include <vector>
 
 #include "base/mesh.h"
 #include "convex.h"
+#include "entity_factory.h" // EntityType
+
+struct IGame;
 
 struct Room
 {
   Vec3f startpos;
 
+  // spawner config value, parsed once at loading
+  struct Property
+  {
+    std::string name;
+    std::string value;
+    int intValue;
+  };
+
   struct Thing
   {
     Vector pos;
-    std::string name;
-    std::map<std::string, std::string> config;
+    EntityType type;
+    std::vector<Property> config;
   };
 
   struct Light
@@ -45,3 +55,6 @@ struct Room
 
 Room loadRoom(String filename);
 
+// creates the entities described by the room things
+void spawnEntities(Room const& room, IGame* game);
+
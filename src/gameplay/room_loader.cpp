@@ -10,7 +10,7 @@
 #include "base/span.h"
 #include "room.h"
 #include <algorithm>
-#include <map>
+#include <cstdlib> // atoi
 #include <stdexcept>
 
 static Vec3f toVec3f(Mesh::Vertex v)
@@ -23,6 +23,22 @@ static bool startsWith(std::string s, std::string prefix)
   return s.substr(0, prefix.size()) == prefix;
 }
 
+// the last definition wins
+static void setProperty(std::vector<Room::Property>& config, std::string const& name, std::string const& value)
+{
+  for(auto& prop : config)
+  {
+    if(prop.name == name)
+    {
+      prop.value = value;
+      prop.intValue = atoi(value.c_str());
+      return;
+    }
+  }
+
+  config.push_back({ name, value, atoi(value.c_str()) });
+}
+
 Room loadRoom(String filename)
 {
   Room r;
@@ -45,14 +61,14 @@ Room loadRoom(String filename)
 
     std::string typeName;
 
-    std::map<std::string, std::string> config;
+    std::vector<Room::Property> config;
 
     for(auto& prop : mesh.properties)
     {
       if(prop.name == "type")
         typeName = prop.value;
       else
-        config[prop.name] = prop.value;
+        setProperty(config, prop.name, prop.value);
     }
 
     if(typeName.size())
@@ -66,7 +82,7 @@ Room loadRoom(String filename)
       }
       else
       {
-        r.things.push_back({ Vec3f(pos.x, pos.y, pos.z), typeName, config });
+        r.things.push_back({ Vec3f(pos.x, pos.y, pos.z), findEntityType(typeName), std::move(config) });
       }
 
       continue;
@@ -8,12 +8,13 @@
 
 #include <algorithm>
 #include <list>
-#include <map>
 
 #include "base/scene.h"
 #include "base/string.h"
 #include "base/util.h"
 #include "misc/file.h"
+#include "misc/pvs.h"
+#include "misc/stats.h"
 
 #include "entity_factory.h"
 #include "game.h"
@@ -25,9 +26,12 @@
 #include "variable.h"
 
 std::unique_ptr<Player> makeHero();
+extern const Span<const Resource> AllResources;
 
 namespace
 {
+Gauge ggStaticLights("Static lights sent");
+
 Actor getDebugActor(Entity* entity)
 {
   auto rect = entity->getBox();
@@ -36,44 +40,63 @@ Actor getDebugActor(Entity* entity)
   return r;
 }
 
+// Read-only view on the spawner config: no copy
 struct EntityConfigImpl : IEntityConfig
 {
-  std::string getString(const char* varName, std::string defaultValue) override
+  EntityConfigImpl(std::vector<Room::Property> const& values_) : values(values_)
+  {
+  }
+
+  const std::string& getString(const char* varName, const std::string& defaultValue) override
   {
-    auto i = values.find(varName);
+    auto prop = find(varName);
 
-    if(i == values.end())
+    if(!prop)
       return defaultValue;
 
-    return i->second;
+    return prop->value;
   }
 
   int getInt(const char* varName, int defaultValue) override
   {
-    auto i = values.find(varName);
+    auto prop = find(varName);
 
-    if(i == values.end())
+    if(!prop)
       return defaultValue;
 
-    return atoi(i->second.c_str());
+    return prop->intValue;
   }
 
-  std::map<std::string, std::string> values;
+  // configs only hold a handful of values: a linear scan is the fastest
+  const Room::Property* find(const char* varName) const
+  {
+    for(auto& prop : values)
+    {
+      if(prop.name == varName)
+        return &prop;
+    }
+
+    return nullptr;
+  }
+
+  std::vector<Room::Property> const& values;
 };
+}
 
 void spawnEntities(Room const& room, IGame* game)
 {
   for(auto& spawner : room.things)
   {
-    EntityConfigImpl config;
-    config.values = spawner.config;
+    EntityConfigImpl config(spawner.config);
 
-    auto entity = createEntity(spawner.name, &config);
+    auto entity = createEntity(spawner.type, &config);
     entity->pos = spawner.pos;
     game->spawn(entity.release());
   }
 }
 
+namespace
+{
 struct TriangleSoup : Shape
 {
   Trace raycast(Vec3f A, Vec3f B, Vec3f boxHalfSize) const override
@@ -148,8 +171,24 @@ struct GameState : Scene, private IGame
       if(0)
         m_view->sendLight(playerLight);
 
+      // A light can reach surfaces of other cells,
+      // so it's kept if any cell within its range is visible from the player's cell.
+      const int playerCell = m_pvs ? m_pvs->getCell(m_player->getCenter()) : -1;
+
+      int sentCount = 0;
+
       for(auto light: m_staticLevelLights)
+      {
+        const auto reach = Vec3f(1, 1, 1) * light.getRange();
+
+        if(playerCell >= 0 && !m_pvs->isBoxVisible(playerCell, light.pos - reach, light.pos + reach))
+          continue;
+
         m_view->sendLight(light);
+        ++sentCount;
+      }
+
+      ggStaticLights = sentCount;
     }
 
     for(auto& entity : m_entities)
@@ -232,11 +271,27 @@ struct GameState : Scene, private IGame
 
     printf("[gameplay] loading level %d\n", levelIdx);
 
+    // drop what the previous level didn't use
+    m_view->evictUnusedResources();
+
     {
       const auto filename = format(buf, "res/rooms/%02d/room.render", levelIdx);
       m_view->preload(Resource { ResourceType::Model, MDL_ROOMS, filename });
     }
 
+    // sounds get played from the gameplay ticks: don't load them there
+    for(auto res : AllResources)
+      if(res.type == ResourceType::Sound)
+        m_view->preload(res);
+
+    {
+      // computed by the mesh cooker, only for rooms big enough.
+      // Loaded once: the renderer culls the room chunks with the same one.
+      const auto filename = format(buf, "res/rooms/%02d/room.pvs", levelIdx);
+      m_pvs = File::exists(filename) ? std::make_shared<const Pvs>(loadPvs(filename)) : nullptr;
+      m_view->setModelPvs(MDL_ROOMS, m_pvs);
+    }
+
     {
       float ambientLight = 1.0;
       const auto filename = format(buf, "res/rooms/%02d/room.settings", levelIdx);
@@ -323,6 +378,7 @@ struct GameState : Scene, private IGame
   int m_level = 1;
   bool m_levelIsLoaded = false;
   std::vector<LightActor> m_staticLevelLights;
+  std::shared_ptr<const Pvs> m_pvs; // can be null
 
   std::vector<std::unique_ptr<Event>> m_eventQueue;
 
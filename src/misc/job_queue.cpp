@@ -0,0 +1,114 @@
+// Copyright (C) 2026 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+#include "job_queue.h"
+
+#include "time.h"
+#include <cstdio>
+#include <system_error>
+
+JobQueue::JobQueue(int workerCount)
+{
+  try
+  {
+    for(int i = 0; i < workerCount; ++i)
+      m_workers.push_back(std::thread([this] () { workerMain(); }));
+  }
+  catch(std::system_error const& e)
+  {
+    printf("[jobs] can't create worker threads (%s), jobs will run on the main thread\n", e.what());
+  }
+}
+
+JobQueue::~JobQueue()
+{
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_quit = true;
+    m_pending.clear();
+  }
+
+  m_wakeUp.notify_all();
+
+  for(auto& worker : m_workers)
+    worker.join();
+}
+
+void JobQueue::push(Delegate<void()> work, Delegate<void()> done)
+{
+  auto job = std::make_unique<Job>();
+  job->work = std::move(work);
+  job->done = std::move(done);
+
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_pending.push_back(std::move(job));
+  }
+
+  m_wakeUp.notify_one();
+}
+
+int JobQueue::poll(int64_t budgetUs)
+{
+  const auto deadline = GetSteadyClockUs() + budgetUs;
+  bool first = true;
+
+  while(first || GetSteadyClockUs() < deadline)
+  {
+    first = false;
+
+    std::unique_ptr<Job> job;
+
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+
+      if(!m_finished.empty())
+      {
+        job = std::move(m_finished.front());
+        m_finished.pop_front();
+      }
+      else if(m_workers.empty() && !m_pending.empty())
+      {
+        job = std::move(m_pending.front());
+        m_pending.pop_front();
+        lock.unlock();
+        job->work();
+      }
+    }
+
+    if(!job)
+      break;
+
+    job->done();
+  }
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  return int(m_pending.size() + m_finished.size()) + m_running;
+}
+
+void JobQueue::workerMain()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+
+  while(true)
+  {
+    m_wakeUp.wait(lock, [this] () { return m_quit || !m_pending.empty(); });
+
+    if(m_quit)
+      break;
+
+    auto job = std::move(m_pending.front());
+    m_pending.pop_front();
+    ++m_running;
+
+    lock.unlock();
+    job->work();
+    lock.lock();
+
+    --m_running;
+    m_finished.push_back(std::move(job));
+  }
+}
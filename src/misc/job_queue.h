@@ -0,0 +1,58 @@
+// Copyright (C) 2026 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+// Background jobs, e.g loading resources.
+// The slow part of a job (reading, decoding) runs on a worker thread,
+// and its completion (e.g uploading to the GPU) on the thread calling 'poll'.
+// Where threads can't be created (e.g the web version),
+// the whole jobs run from 'poll' instead.
+
+#pragma once
+
+#include "base/delegate.h"
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct JobQueue
+{
+  JobQueue(int workerCount);
+
+  // Waits for the running jobs. The others are dropped, and never complete.
+  ~JobQueue();
+
+  // 'work' runs on a worker thread, and must not throw.
+  // 'done' runs later, from 'poll'.
+  void push(Delegate<void()> work, Delegate<void()> done);
+
+  // Completes the finished jobs, until 'budgetUs' microseconds have elapsed.
+  // At least one job gets completed, if any, so loading always makes progress.
+  // Returns the number of jobs not completed yet.
+  int poll(int64_t budgetUs);
+
+  int getWorkerCount() const { return (int)m_workers.size(); }
+
+private:
+  struct Job
+  {
+    Delegate<void()> work;
+    Delegate<void()> done;
+  };
+
+  void workerMain();
+
+  std::mutex m_mutex;
+  std::condition_variable m_wakeUp;
+  std::deque<std::unique_ptr<Job>> m_pending; // 'work' not started yet
+  std::deque<std::unique_ptr<Job>> m_finished; // 'done' not called yet
+  int m_running = 0;
+  bool m_quit = false;
+  std::vector<std::thread> m_workers;
+};
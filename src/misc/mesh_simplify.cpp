@@ -0,0 +1,332 @@
+// Copyright (C) 2026 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+#include "mesh_simplify.h"
+
+#include <algorithm> // sort, max, swap
+#include <cmath> // sqrt, fabs
+#include <map>
+#include <utility> // pair
+
+namespace
+{
+// Sum of squared distances to a set of planes
+struct Quadric
+{
+  double a2 = 0, ab = 0, ac = 0, ad = 0;
+  double b2 = 0, bc = 0, bd = 0;
+  double c2 = 0, cd = 0;
+  double d2 = 0;
+  double weight = 0;
+
+  // plane: dot(n, p) + d = 0, with 'n' normalized
+  void addPlane(Vec3f n, double d, double weight)
+  {
+    a2 += weight * n.x * n.x;
+    ab += weight * n.x * n.y;
+    ac += weight * n.x * n.z;
+    ad += weight * n.x * d;
+    b2 += weight * n.y * n.y;
+    bc += weight * n.y * n.z;
+    bd += weight * n.y * d;
+    c2 += weight * n.z * n.z;
+    cd += weight * n.z * d;
+    d2 += weight * d * d;
+    this->weight += weight;
+  }
+
+  void operator += (Quadric const& o)
+  {
+    a2 += o.a2;
+    ab += o.ab;
+    ac += o.ac;
+    ad += o.ad;
+    b2 += o.b2;
+    bc += o.bc;
+    bd += o.bd;
+    c2 += o.c2;
+    cd += o.cd;
+    d2 += o.d2;
+    weight += o.weight;
+  }
+
+  double eval(Vec3f p) const
+  {
+    const double x = p.x, y = p.y, z = p.z;
+    const double r = a2 * x * x + b2 * y * y + c2 * z * z
+      + 2 * (ab * x * y + ac * x * z + bc * y * z)
+      + 2 * (ad * x + bd * y + cd * z)
+      + d2;
+    return std::max(r, 0.0);
+  }
+
+  // mean squared distance to the planes
+  double meanEval(Vec3f p) const
+  {
+    return weight > 0 ? eval(p) / weight : 0;
+  }
+};
+
+struct Plane
+{
+  Vec3f n;
+  float d;
+};
+
+// Element of the list of original planes around a vertex
+struct PlaneLink
+{
+  int plane;
+  int next; // -1 at the end of the list
+};
+
+struct Collapse
+{
+  uint32_t from;
+  uint32_t to;
+  double cost;
+};
+}
+
+std::vector<uint32_t> simplifyMesh(Span<const uint32_t> indices, Span<const Vec3f> positions, int targetTriangleCount, float& error)
+{
+  const int vertexCount = positions.len;
+
+  std::vector<uint32_t> result(indices.begin(), indices.end());
+  error = 0;
+
+  // Per vertex quadrics. Not weighted by area: the cost of a collapse is
+  // the mean squared distance to the original planes around both vertices.
+  std::vector<Quadric> quadrics(vertexCount);
+
+  // Original planes around each vertex, for the actual error:
+  // collapsing a vertex appends its list to the one of its target.
+  std::vector<Plane> planes;
+  std::vector<PlaneLink> planeLinks;
+  std::vector<int> firstPlane(vertexCount, -1);
+  std::vector<int> lastPlane(vertexCount, -1);
+
+  for(int t = 0; t * 3 < (int)result.size(); ++t)
+  {
+    auto p0 = positions.data[result[t * 3 + 0]];
+    auto p1 = positions.data[result[t * 3 + 1]];
+    auto p2 = positions.data[result[t * 3 + 2]];
+
+    auto n = crossProduct(p1 - p0, p2 - p0);
+    const auto len = sqrt(dotProduct(n, n));
+
+    if(len == 0)
+      continue;
+
+    n = n * float(1.0 / len);
+
+    Quadric q;
+    q.addPlane(n, -dotProduct(n, p0), 1);
+
+    for(int k = 0; k < 3; ++k)
+    {
+      const auto v = result[t * 3 + k];
+      quadrics[v] += q;
+
+      planeLinks.push_back({ (int)planes.size(), firstPlane[v] });
+      firstPlane[v] = planeLinks.size() - 1;
+
+      if(lastPlane[v] < 0)
+        lastPlane[v] = firstPlane[v];
+    }
+
+    planes.push_back({ n, -dotProduct(n, p0) });
+  }
+
+  // the vertices of the edges not shared by exactly two triangles can't move
+  std::vector<bool> locked(vertexCount);
+
+  {
+    std::map<std::pair<uint32_t, uint32_t>, int> edgeUseCount;
+
+    for(int i = 0; i < (int)result.size(); i += 3)
+    {
+      for(int k = 0; k < 3; ++k)
+      {
+        auto a = result[i + k];
+        auto b = result[i + (k + 1) % 3];
+        ++edgeUseCount[std::make_pair(std::min(a, b), std::max(a, b))];
+      }
+    }
+
+    for(auto& edge : edgeUseCount)
+    {
+      if(edge.second != 2)
+      {
+        locked[edge.first.first] = true;
+        locked[edge.first.second] = true;
+      }
+    }
+  }
+
+  std::vector<Collapse> candidates;
+  std::vector<int> firstAdjacent(vertexCount + 1);
+  std::vector<int> adjacency;
+  std::vector<bool> touched(vertexCount);
+  std::vector<uint32_t> remap(vertexCount);
+  double maxDistance = 0;
+
+  // Each pass collapses the cheapest edges, at most one per vertex neighbourhood.
+  while((int)result.size() / 3 > targetTriangleCount)
+  {
+    const int triangleCount = result.size() / 3;
+
+    // triangles around each vertex
+    std::fill(firstAdjacent.begin(), firstAdjacent.end(), 0);
+
+    for(auto index : result)
+      ++firstAdjacent[index + 1];
+
+    for(int v = 0; v < vertexCount; ++v)
+      firstAdjacent[v + 1] += firstAdjacent[v];
+
+    adjacency.resize(result.size());
+
+    {
+      auto cursor = firstAdjacent;
+
+      for(int i = 0; i < (int)result.size(); ++i)
+        adjacency[cursor[result[i]]++] = i / 3;
+    }
+
+    candidates.clear();
+
+    for(int i = 0; i < (int)result.size(); i += 3)
+    {
+      for(int k = 0; k < 3; ++k)
+      {
+        auto a = result[i + k];
+        auto b = result[i + (k + 1) % 3];
+
+        for(int dir = 0; dir < 2; ++dir)
+        {
+          if(!locked[a])
+          {
+            Quadric q = quadrics[a];
+            q += quadrics[b];
+            candidates.push_back({ a, b, q.meanEval(positions.data[b]) });
+          }
+
+          std::swap(a, b);
+        }
+      }
+    }
+
+    std::sort(candidates.begin(), candidates.end(), [] (Collapse const& x, Collapse const& y) { return x.cost < y.cost; });
+
+    // moving 'from' onto 'to' must not flip any of the remaining triangles
+    auto flips = [&] (Collapse const& c)
+      {
+        for(int k = firstAdjacent[c.from]; k < firstAdjacent[c.from + 1]; ++k)
+        {
+          const int t = adjacency[k];
+          const uint32_t* tri = &result[t * 3];
+
+          if(tri[0] == c.to || tri[1] == c.to || tri[2] == c.to)
+            continue; // collapsed
+
+          Vec3f before[3], after[3];
+
+          for(int j = 0; j < 3; ++j)
+          {
+            before[j] = positions.data[tri[j]];
+            after[j] = tri[j] == c.from ? positions.data[c.to] : before[j];
+          }
+
+          const auto n0 = crossProduct(before[1] - before[0], before[2] - before[0]);
+          const auto n1 = crossProduct(after[1] - after[0], after[2] - after[0]);
+
+          if(dotProduct(n0, n1) <= 0)
+            return true;
+        }
+
+        return false;
+      };
+
+    std::fill(touched.begin(), touched.end(), false);
+
+    for(int v = 0; v < vertexCount; ++v)
+      remap[v] = v;
+
+    int removed = 0;
+    int collapses = 0;
+
+    for(auto& c : candidates)
+    {
+      if(triangleCount - removed <= targetTriangleCount)
+        break;
+
+      if(touched[c.from] || touched[c.to])
+        continue;
+
+      if(flips(c))
+        continue;
+
+      remap[c.from] = c.to;
+      quadrics[c.to] += quadrics[c.from];
+      ++collapses;
+
+      // 'from', and the vertices already collapsed onto it, move to 'to'
+      for(int k = firstPlane[c.from]; k >= 0; k = planeLinks[k].next)
+      {
+        auto const& plane = planes[planeLinks[k].plane];
+        maxDistance = std::max(maxDistance, fabs(dotProduct(plane.n, positions.data[c.to]) + plane.d));
+      }
+
+      if(firstPlane[c.from] >= 0)
+      {
+        if(firstPlane[c.to] < 0)
+          firstPlane[c.to] = firstPlane[c.from];
+        else
+          planeLinks[lastPlane[c.to]].next = firstPlane[c.from];
+
+        lastPlane[c.to] = lastPlane[c.from];
+      }
+
+      // the neighbourhood of 'from' changes shape: leave it alone until the next pass
+      for(int k = firstAdjacent[c.from]; k < firstAdjacent[c.from + 1]; ++k)
+      {
+        const uint32_t* tri = &result[adjacency[k] * 3];
+
+        if(tri[0] == c.to || tri[1] == c.to || tri[2] == c.to)
+          ++removed;
+
+        for(int j = 0; j < 3; ++j)
+          touched[tri[j]] = true;
+      }
+    }
+
+    if(collapses == 0)
+      break;
+
+    // apply the collapses, drop the degenerate triangles
+    int dst = 0;
+
+    for(int i = 0; i < (int)result.size(); i += 3)
+    {
+      const auto a = remap[result[i + 0]];
+      const auto b = remap[result[i + 1]];
+      const auto c = remap[result[i + 2]];
+
+      if(a == b || b == c || c == a)
+        continue;
+
+      result[dst++] = a;
+      result[dst++] = b;
+      result[dst++] = c;
+    }
+
+    result.resize(dst);
+  }
+
+  error = (float)maxDistance;
+  return result;
+}
@@ -0,0 +1,24 @@
+// Copyright (C) 2026 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+// Mesh simplification, for the generation of LODs.
+// 'indices' always holds 3 indices per triangle.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "base/geom.h"
+#include "base/span.h"
+
+// Quadric error edge collapse (Garland & Heckbert 1997).
+// A vertex can only be collapsed onto one of its neighbours, so the result
+// uses a subset of the input vertices, and can share their vertex buffer.
+// The vertices of the open edges (borders, uv seams) never move.
+// 'error' receives the largest distance of a collapsed vertex to the
+// original planes around it, in the unit of 'positions'.
+std::vector<uint32_t> simplifyMesh(Span<const uint32_t> indices, Span<const Vec3f> positions, int targetTriangleCount, float& error);
@@ -0,0 +1,303 @@
+// Copyright (C) 2026 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+#include "pvs.h"
+
+#include <algorithm> // min, max
+#include <cmath> // floor, sqrt
+#include <cstring> // memcpy
+
+#include "base/error.h"
+#include "file.h"
+
+namespace
+{
+const char Magic[4] = { 'P', 'V', 'S', '1' };
+
+// Moller-Trumbore, restricted to the segment [orig, orig + dir]
+bool segmentHitsTriangle(Vec3f orig, Vec3f dir, const Vec3f* tri)
+{
+  const auto e1 = tri[1] - tri[0];
+  const auto e2 = tri[2] - tri[0];
+  const auto h = crossProduct(dir, e2);
+  const auto a = dotProduct(e1, h);
+
+  if(fabs(a) < 1e-9)
+    return false; // parallel
+
+  const auto f = 1.0f / a;
+  const auto s = orig - tri[0];
+  const auto u = f * dotProduct(s, h);
+
+  if(u < 0 || u > 1)
+    return false;
+
+  const auto q = crossProduct(s, e1);
+  const auto v = f * dotProduct(dir, q);
+
+  if(v < 0 || u + v > 1)
+    return false;
+
+  const auto t = f * dotProduct(e2, q);
+  return t > 0.001 && t < 0.999;
+}
+
+// Returns the range of cells overlapped by the box, clamped to the grid
+void getCellRange(Pvs const& pvs, Vec3f boxMin, Vec3f boxMax, int (& first)[3], int (& last)[3])
+{
+  const float lo[3] = { boxMin.x - pvs.origin.x, boxMin.y - pvs.origin.y, boxMin.z - pvs.origin.z };
+  const float hi[3] = { boxMax.x - pvs.origin.x, boxMax.y - pvs.origin.y, boxMax.z - pvs.origin.z };
+
+  for(int i = 0; i < 3; ++i)
+  {
+    first[i] = std::max(0, (int)floor(lo[i] / pvs.cellSize));
+    last[i] = std::min(pvs.dim[i] - 1, (int)floor(hi[i] / pvs.cellSize));
+  }
+}
+
+void setVisible(Pvs& pvs, int fromCell, int toCell)
+{
+  const int rowSize = (pvs.cellCount() + 7) / 8;
+  pvs.bits[fromCell * rowSize + toCell / 8] |= (1 << (toCell % 8));
+}
+}
+
+int Pvs::getCell(Vec3f pos) const
+{
+  if(empty())
+    return -1;
+
+  const float p[3] = { pos.x - origin.x, pos.y - origin.y, pos.z - origin.z };
+  int c[3];
+
+  for(int i = 0; i < 3; ++i)
+  {
+    c[i] = (int)floor(p[i] / cellSize);
+
+    if(c[i] < 0 || c[i] >= dim[i])
+      return -1;
+  }
+
+  return c[0] + dim[0] * (c[1] + dim[1] * c[2]);
+}
+
+bool Pvs::isBoxVisible(int fromCell, Vec3f boxMin, Vec3f boxMax) const
+{
+  int first[3], last[3];
+  getCellRange(*this, boxMin, boxMax, first, last);
+
+  if(first[0] > last[0] || first[1] > last[1] || first[2] > last[2])
+    return true; // outside of the grid: we know nothing about it
+
+  for(int z = first[2]; z <= last[2]; ++z)
+    for(int y = first[1]; y <= last[1]; ++y)
+      for(int x = first[0]; x <= last[0]; ++x)
+        if(isVisible(fromCell, x + dim[0] * (y + dim[1] * z)))
+          return true;
+
+  return false;
+}
+
+Pvs computePvs(Span<const Vec3f> occluders, float cellSize, int raysPerPair)
+{
+  Pvs pvs;
+
+  const int triangleCount = occluders.len / 3;
+
+  if(triangleCount == 0)
+    return pvs;
+
+  Vec3f boundsMin = occluders[0];
+  Vec3f boundsMax = occluders[0];
+
+  for(auto& v : occluders)
+  {
+    boundsMin = Vec3f(std::min(boundsMin.x, v.x), std::min(boundsMin.y, v.y), std::min(boundsMin.z, v.z));
+    boundsMax = Vec3f(std::max(boundsMax.x, v.x), std::max(boundsMax.y, v.y), std::max(boundsMax.z, v.z));
+  }
+
+  pvs.cellSize = cellSize;
+  pvs.origin = boundsMin;
+  pvs.dim[0] = (int)floor((boundsMax.x - boundsMin.x) / cellSize) + 1;
+  pvs.dim[1] = (int)floor((boundsMax.y - boundsMin.y) / cellSize) + 1;
+  pvs.dim[2] = (int)floor((boundsMax.z - boundsMin.z) / cellSize) + 1;
+
+  const int cellCount = pvs.cellCount();
+  pvs.bits.resize(cellCount * ((cellCount + 7) / 8));
+
+  // triangles overlapping each cell
+  std::vector<std::vector<int>> cellTriangles(cellCount);
+
+  for(int t = 0; t < triangleCount; ++t)
+  {
+    auto tri = &occluders[t * 3];
+
+    Vec3f triMin = tri[0];
+    Vec3f triMax = tri[0];
+
+    for(int k = 1; k < 3; ++k)
+    {
+      triMin = Vec3f(std::min(triMin.x, tri[k].x), std::min(triMin.y, tri[k].y), std::min(triMin.z, tri[k].z));
+      triMax = Vec3f(std::max(triMax.x, tri[k].x), std::max(triMax.y, tri[k].y), std::max(triMax.z, tri[k].z));
+    }
+
+    int first[3], last[3];
+    getCellRange(pvs, triMin, triMax, first, last);
+
+    for(int z = first[2]; z <= last[2]; ++z)
+      for(int y = first[1]; y <= last[1]; ++y)
+        for(int x = first[0]; x <= last[0]; ++x)
+          cellTriangles[x + pvs.dim[0] * (y + pvs.dim[1] * z)].push_back(t);
+  }
+
+  // avoids testing the same triangle twice for the same ray
+  std::vector<int> mailbox(triangleCount, -1);
+  int rayId = 0;
+
+  // Walks the cells crossed by the segment, in small steps.
+  // Cells only grazed by the segment might be skipped: this can only
+  // make the result more conservative.
+  auto isBlocked = [&] (Vec3f a, Vec3f b)
+    {
+      ++rayId;
+
+      const auto delta = b - a;
+      const int steps = std::max(1, (int)ceil(sqrt(dotProduct(delta, delta)) / (cellSize * 0.25f)));
+      int prevCell = -1;
+
+      for(int s = 0; s <= steps; ++s)
+      {
+        const int cell = pvs.getCell(a + delta * (s / (float)steps));
+
+        if(cell < 0 || cell == prevCell)
+          continue;
+
+        prevCell = cell;
+
+        for(auto t : cellTriangles[cell])
+        {
+          if(mailbox[t] == rayId)
+            continue;
+
+          mailbox[t] = rayId;
+
+          if(segmentHitsTriangle(a, delta, &occluders[t * 3]))
+            return true;
+        }
+      }
+
+      return false;
+    };
+
+  // deterministic, so cooking twice gives the same result
+  uint32_t seed = 2463534242u;
+
+  auto random = [&] ()
+    {
+      seed ^= seed << 13;
+      seed ^= seed >> 17;
+      seed ^= seed << 5;
+      return (seed & 0xFFFFFF) / float(0x1000000);
+    };
+
+  auto randomPointInCell = [&] (int x, int y, int z)
+    {
+      return pvs.origin + Vec3f(x + random(), y + random(), z + random()) * cellSize;
+    };
+
+  for(int a = 0; a < cellCount; ++a)
+  {
+    const int ax = a % pvs.dim[0];
+    const int ay = (a / pvs.dim[0]) % pvs.dim[1];
+    const int az = a / (pvs.dim[0] * pvs.dim[1]);
+
+    setVisible(pvs, a, a);
+
+    for(int b = a + 1; b < cellCount; ++b)
+    {
+      const int bx = b % pvs.dim[0];
+      const int by = (b / pvs.dim[0]) % pvs.dim[1];
+      const int bz = b / (pvs.dim[0] * pvs.dim[1]);
+
+      bool visible = abs(ax - bx) <= 1 && abs(ay - by) <= 1 && abs(az - bz) <= 1;
+
+      for(int k = 0; !visible && k < raysPerPair; ++k)
+        visible = !isBlocked(randomPointInCell(ax, ay, az), randomPointInCell(bx, by, bz));
+
+      if(visible)
+      {
+        setVisible(pvs, a, b);
+        setVisible(pvs, b, a);
+      }
+    }
+  }
+
+  return pvs;
+}
+
+std::vector<uint8_t> serializePvs(Pvs const& pvs)
+{
+  std::vector<uint8_t> data;
+
+  auto write = [&] (const void* ptr, size_t size)
+    {
+      const auto i = data.size();
+      data.resize(i + size);
+      memcpy(&data[i], ptr, size);
+    };
+
+  write(Magic, sizeof Magic);
+  write(&pvs.cellSize, 4);
+  write(&pvs.origin.x, 4);
+  write(&pvs.origin.y, 4);
+  write(&pvs.origin.z, 4);
+  write(pvs.dim, sizeof pvs.dim);
+  write(pvs.bits.data(), pvs.bits.size());
+
+  return data;
+}
+
+Pvs deserializePvs(Span<const uint8_t> data)
+{
+  int readPosition = 0;
+
+  auto read = [&] (void* ptr, int size)
+    {
+      if(readPosition + size > data.len)
+        throw Error("Truncated PVS data");
+
+      memcpy(ptr, &data.data[readPosition], size);
+      readPosition += size;
+    };
+
+  char magic[4];
+  read(magic, sizeof magic);
+
+  if(memcmp(magic, Magic, sizeof magic))
+    throw Error("Invalid PVS data");
+
+  Pvs pvs;
+  read(&pvs.cellSize, 4);
+  read(&pvs.origin.x, 4);
+  read(&pvs.origin.y, 4);
+  read(&pvs.origin.z, 4);
+  read(pvs.dim, sizeof pvs.dim);
+
+  if(pvs.cellSize <= 0 || pvs.dim[0] <= 0 || pvs.dim[1] <= 0 || pvs.dim[2] <= 0)
+    throw Error("Invalid PVS data");
+
+  const int cellCount = pvs.cellCount();
+  pvs.bits.resize(cellCount * ((cellCount + 7) / 8));
+  read(pvs.bits.data(), pvs.bits.size());
+
+  return pvs;
+}
+
+Pvs loadPvs(String path)
+{
+  const auto data = File::read(path);
+  return deserializePvs({ (const uint8_t*)data.data(), (int)data.size() });
+}
@@ -0,0 +1,51 @@
+// Copyright (C) 2026 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+// Potentially visible set: cell-to-cell visibility, computed offline.
+// The cells are the ones of a regular grid covering the whole room.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "base/geom.h"
+#include "base/span.h"
+#include "base/string.h"
+
+struct Pvs
+{
+  float cellSize = 0;
+  Vec3f origin; // lowest corner of the grid
+  int dim[3] {};
+
+  // for each cell, a bitfield of the cells visible from it
+  std::vector<uint8_t> bits;
+
+  bool empty() const { return cellCount() == 0; }
+  int cellCount() const { return dim[0] * dim[1] * dim[2]; }
+
+  // returns -1 if 'pos' is outside of the grid
+  int getCell(Vec3f pos) const;
+
+  bool isVisible(int fromCell, int toCell) const
+  {
+    const int rowSize = (cellCount() + 7) / 8;
+    return bits[fromCell * rowSize + toCell / 8] & (1 << (toCell % 8));
+  }
+
+  // true if any cell overlapped by the box is visible from 'fromCell'.
+  bool isBoxVisible(int fromCell, Vec3f boxMin, Vec3f boxMax) const;
+};
+
+// 'occluders' is a triangle soup, 3 vertices per triangle.
+// Visibility is sampled by casting 'raysPerPair' rays between random points
+// of each pair of cells. Neighbour cells always see each other.
+Pvs computePvs(Span<const Vec3f> occluders, float cellSize, int raysPerPair = 64);
+
+std::vector<uint8_t> serializePvs(Pvs const& pvs);
+Pvs deserializePvs(Span<const uint8_t> data);
+Pvs loadPvs(String path);
@@ -0,0 +1,57 @@
+// Copyright (C) 2026 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+#include "radix_sort.h"
+
+#include <cassert>
+#include <utility> // swap
+
+void radixSort(Span<SortEntry> entries, Span<SortEntry> scratch)
+{
+  assert(scratch.len >= entries.len);
+
+  if(entries.len < 2)
+    return;
+
+  // one histogram per 8-bit digit, all computed in a single pass
+  int histograms[8][256] {};
+
+  for(auto& entry : entries)
+    for(int digit = 0; digit < 8; ++digit)
+      ++histograms[digit][(entry.key >> (digit * 8)) & 0xFF];
+
+  auto src = entries.data;
+  auto dst = scratch.data;
+
+  for(int digit = 0; digit < 8; ++digit)
+  {
+    auto& histogram = histograms[digit];
+
+    // all the keys have the same value for this digit: nothing to do
+    if(histogram[(src[0].key >> (digit * 8)) & 0xFF] == entries.len)
+      continue;
+
+    int offsets[256];
+    int sum = 0;
+
+    for(int i = 0; i < 256; ++i)
+    {
+      offsets[i] = sum;
+      sum += histogram[i];
+    }
+
+    for(int i = 0; i < entries.len; ++i)
+      dst[offsets[(src[i].key >> (digit * 8)) & 0xFF]++] = src[i];
+
+    std::swap(src, dst);
+  }
+
+  if(src != entries.data)
+  {
+    for(int i = 0; i < entries.len; ++i)
+      entries.data[i] = src[i];
+  }
+}
@@ -0,0 +1,23 @@
+// Copyright (C) 2026 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+// LSD radix sort, on 64-bit keys.
+
+#pragma once
+
+#include <cstdint>
+
+#include "base/span.h"
+
+struct SortEntry
+{
+  uint64_t key;
+  int index; // what the key was computed from
+};
+
+// Stable. 'scratch' must be as large as 'entries'.
+// The digits shared by all the keys are skipped.
+void radixSort(Span<SortEntry> entries, Span<SortEntry> scratch);
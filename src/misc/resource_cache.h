@@ -0,0 +1,121 @@
+// Copyright (C) 2026 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+// Keeps the loaded resources around once they're not used anymore,
+// so coming back to the same content doesn't load them again.
+// When the total size goes over the budget, the least recently used
+// resources nobody holds anymore get evicted first.
+
+#pragma once
+
+#include "base/delegate.h"
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <unordered_map>
+
+template<typename Key, typename T>
+struct ResourceCache
+{
+  // Loads the resource on a miss.
+  // Exceptions thrown by 'onCacheMiss' go through, and nothing gets cached.
+  std::shared_ptr<T> fetch(Key key)
+  {
+    auto i = m_index.find(key);
+
+    if(i != m_index.end())
+    {
+      ++stats.hits;
+      m_entries.splice(m_entries.begin(), m_entries, i->second);
+      return i->second->resource;
+    }
+
+    ++stats.misses;
+
+    Entry entry;
+    entry.key = key;
+    entry.resource = onCacheMiss(key, entry.bytes);
+
+    m_bytes += entry.bytes;
+    m_entries.push_front(std::move(entry));
+    m_index[key] = m_entries.begin();
+
+    auto r = m_entries.front().resource;
+    trim();
+    return r;
+  }
+
+  // Same as 'fetch', but the resource is never evicted
+  std::shared_ptr<T> pin(Key key)
+  {
+    auto r = fetch(key);
+    m_index[key]->pinned = true;
+    return r;
+  }
+
+  // Evicts the least recently used resources until the total size fits in the budget.
+  // Resources still held outside of the cache stay, whatever their size.
+  void trim()
+  {
+    auto i = m_entries.end();
+
+    while(m_bytes > budget && i != m_entries.begin())
+    {
+      --i;
+
+      if(i->pinned || i->resource.use_count() > 1)
+        continue;
+
+      m_bytes -= i->bytes;
+      m_index.erase(i->key);
+      i = m_entries.erase(i);
+      ++stats.evictions;
+    }
+  }
+
+  // For the resources loaded in the background, whose size isn't known on a miss
+  void setBytes(Key key, int64_t bytes)
+  {
+    auto i = m_index.find(key);
+
+    if(i == m_index.end())
+      return;
+
+    m_bytes += bytes - i->second->bytes;
+    i->second->bytes = bytes;
+  }
+
+  int64_t getBytes() const { return m_bytes; }
+  int getCount() const { return (int)m_entries.size(); }
+
+  struct Stats
+  {
+    int hits = 0;
+    int misses = 0;
+    int evictions = 0;
+  };
+
+  Stats stats;
+  int64_t budget = 0; // in bytes
+
+  // loads the resource, and returns its size in 'bytes'
+  Delegate<std::shared_ptr<T>(Key, int64_t& bytes)> onCacheMiss;
+
+private:
+  struct Entry
+  {
+    Key key;
+    std::shared_ptr<T> resource;
+    int64_t bytes = 0;
+    bool pinned = false;
+  };
+
+  // most recently used first
+  std::list<Entry> m_entries;
+  std::unordered_map<Key, typename std::list<Entry>::iterator> m_index;
+  int64_t m_bytes = 0;
+};
@@ -0,0 +1,265 @@
+// Copyright (C) 2026 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+#include "vertex_cache.h"
+
+#include <algorithm> // stable_sort, find
+#include <cmath> // sqrt
+
+namespace
+{
+// Number of vertices transformed when drawing 'indices', with a FIFO cache
+int countCacheMisses(Span<const uint32_t> indices)
+{
+  uint32_t cache[VertexCacheSize];
+  int cacheLen = 0;
+  int head = 0;
+  int misses = 0;
+
+  for(auto index : indices)
+  {
+    if(std::find(cache, cache + cacheLen, index) != cache + cacheLen)
+      continue;
+
+    ++misses;
+
+    if(cacheLen < VertexCacheSize)
+      cache[cacheLen++] = index;
+    else
+      cache[head] = index;
+
+    head = (head + 1) % VertexCacheSize;
+  }
+
+  return misses;
+}
+}
+
+std::vector<int> optimizeVertexCache(Span<uint32_t> indices, int vertexCount)
+{
+  const int triangleCount = indices.len / 3;
+
+  // triangles using each vertex
+  std::vector<int> liveCount(vertexCount);
+  std::vector<int> firstAdjacent(vertexCount + 1);
+  std::vector<int> adjacency(triangleCount * 3);
+
+  for(auto index : indices)
+    ++liveCount[index];
+
+  for(int v = 0; v < vertexCount; ++v)
+    firstAdjacent[v + 1] = firstAdjacent[v] + liveCount[v];
+
+  {
+    auto cursor = firstAdjacent;
+
+    for(int i = 0; i < triangleCount * 3; ++i)
+      adjacency[cursor[indices[i]]++] = i / 3;
+  }
+
+  // the vertex 'v' is in the cache if 'time - timestamps[v] <= VertexCacheSize'
+  std::vector<int> timestamps(vertexCount);
+  int time = VertexCacheSize + 1;
+
+  std::vector<bool> emitted(triangleCount);
+  std::vector<uint32_t> deadEnds;
+  std::vector<uint32_t> candidates;
+  std::vector<uint32_t> output;
+  std::vector<int> clusters;
+  int cursor = 0;
+
+  output.reserve(indices.len);
+
+  // vertex with triangles left, in the cache if possible
+  auto skipDeadEnd = [&] ()
+    {
+      while(!deadEnds.empty())
+      {
+        auto v = deadEnds.back();
+        deadEnds.pop_back();
+
+        if(liveCount[v] > 0)
+          return (int)v;
+      }
+
+      while(cursor < indices.len)
+      {
+        auto v = indices[cursor++];
+
+        if(liveCount[v] > 0)
+          return (int)v;
+      }
+
+      return -1;
+    };
+
+  int fanning = skipDeadEnd();
+
+  if(fanning >= 0)
+    clusters.push_back(0);
+
+  while(fanning >= 0)
+  {
+    candidates.clear();
+
+    // emit all the remaining triangles around 'fanning'
+    for(int k = firstAdjacent[fanning]; k < firstAdjacent[fanning + 1]; ++k)
+    {
+      const int t = adjacency[k];
+
+      if(emitted[t])
+        continue;
+
+      for(int j = 0; j < 3; ++j)
+      {
+        const auto v = indices[t * 3 + j];
+        output.push_back(v);
+        deadEnds.push_back(v);
+        candidates.push_back(v);
+        --liveCount[v];
+
+        if(time - timestamps[v] > VertexCacheSize)
+          timestamps[v] = time++;
+      }
+
+      emitted[t] = true;
+    }
+
+    // next fanning vertex: the oldest candidate still in the cache
+    // after its remaining triangles are emitted, or any other one.
+    int next = -1;
+    int bestPriority = -1;
+
+    for(auto v : candidates)
+    {
+      if(liveCount[v] <= 0)
+        continue;
+
+      int priority = 0;
+
+      if(time - timestamps[v] + 2 * liveCount[v] <= VertexCacheSize)
+        priority = time - timestamps[v];
+
+      if(priority > bestPriority)
+      {
+        bestPriority = priority;
+        next = v;
+      }
+    }
+
+    if(next < 0)
+    {
+      next = skipDeadEnd();
+
+      if(next >= 0 && time - timestamps[next] > VertexCacheSize)
+        clusters.push_back(output.size() / 3);
+    }
+
+    fanning = next;
+  }
+
+  std::copy(output.begin(), output.end(), indices.begin());
+
+  return clusters;
+}
+
+void optimizeOverdraw(Span<uint32_t> indices, Span<const int> clusters, Span<const Vec3f> positions)
+{
+  const int triangleCount = indices.len / 3;
+
+  struct Cluster
+  {
+    int firstTriangle;
+    int triangleCount;
+    Vec3f centroid; // sum of the triangle centroids, weighted by area
+    Vec3f normal; // sum of the triangle normals, weighted by area
+    float area;
+    float sortKey;
+  };
+
+  std::vector<Cluster> sorted;
+  Vec3f meshCentroid;
+  float meshArea = 0;
+
+  for(int i = 0; i < clusters.len; ++i)
+  {
+    Cluster c {};
+    c.firstTriangle = clusters.data[i];
+    c.triangleCount = (i + 1 < clusters.len ? clusters.data[i + 1] : triangleCount) - c.firstTriangle;
+
+    for(int t = c.firstTriangle; t < c.firstTriangle + c.triangleCount; ++t)
+    {
+      auto a = positions.data[indices[t * 3 + 0]];
+      auto b = positions.data[indices[t * 3 + 1]];
+      auto d = positions.data[indices[t * 3 + 2]];
+
+      const auto n = crossProduct(b - a, d - a);
+      const auto area = (float)sqrt(dotProduct(n, n));
+
+      c.centroid = c.centroid + (a + b + d) * (area / 3);
+      c.normal = c.normal + n;
+      c.area += area;
+    }
+
+    meshCentroid = meshCentroid + c.centroid;
+    meshArea += c.area;
+    sorted.push_back(c);
+  }
+
+  if(meshArea > 0)
+    meshCentroid = meshCentroid * (1.0f / meshArea);
+
+  // how much the cluster faces away from the center of the mesh
+  for(auto& c : sorted)
+  {
+    const auto normalLength = (float)sqrt(dotProduct(c.normal, c.normal));
+
+    if(c.area > 0 && normalLength > 0)
+      c.sortKey = dotProduct(c.centroid * (1.0f / c.area) - meshCentroid, c.normal) / normalLength;
+  }
+
+  std::stable_sort(sorted.begin(), sorted.end(), [] (Cluster const& a, Cluster const& b) { return a.sortKey > b.sortKey; });
+
+  std::vector<uint32_t> output;
+  output.reserve(indices.len);
+
+  for(auto& c : sorted)
+    output.insert(output.end(), &indices[c.firstTriangle * 3], &indices[c.firstTriangle * 3] + c.triangleCount * 3);
+
+  std::copy(output.begin(), output.end(), indices.begin());
+}
+
+std::vector<uint32_t> optimizeVertexFetch(Span<uint32_t> indices, int vertexCount)
+{
+  const uint32_t Unused = 0xFFFFFFFF;
+
+  std::vector<uint32_t> newIndex(vertexCount, Unused);
+  std::vector<uint32_t> oldIndex;
+
+  for(auto& index : indices)
+  {
+    if(newIndex[index] == Unused)
+    {
+      newIndex[index] = oldIndex.size();
+      oldIndex.push_back(index);
+    }
+
+    index = newIndex[index];
+  }
+
+  return oldIndex;
+}
+
+float computeAcmr(Span<const uint32_t> indices)
+{
+  const int triangleCount = indices.len / 3;
+  return triangleCount ? countCacheMisses(indices) / float(triangleCount) : 0;
+}
+
+float computeAtvr(Span<const uint32_t> indices, int vertexCount)
+{
+  return vertexCount ? countCacheMisses(indices) / float(vertexCount) : 0;
+}
@@ -0,0 +1,39 @@
+// Copyright (C) 2026 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+// Triangle and vertex reordering, for the GPU post-transform vertex cache.
+// 'indices' always holds 3 indices per triangle.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "base/geom.h"
+#include "base/span.h"
+
+// FIFO cache size assumed by the optimizer and by the statistics
+constexpr auto VertexCacheSize = 16;
+
+// Reorders the triangles for vertex cache locality (Tipsify, Sander et al. 2007).
+// Returns the first triangle of each cluster: the places where
+// the reordering had to jump to a region not in the cache anymore.
+std::vector<int> optimizeVertexCache(Span<uint32_t> indices, int vertexCount);
+
+// Reorders the clusters (as returned by optimizeVertexCache) so the ones facing
+// outwards come first: they are likely to hide the others.
+// The order inside a cluster is kept, so is the cache efficiency.
+void optimizeOverdraw(Span<uint32_t> indices, Span<const int> clusters, Span<const Vec3f> positions);
+
+// Renumbers the vertices in the order they are first used.
+// Returns the old index of each new vertex.
+std::vector<uint32_t> optimizeVertexFetch(Span<uint32_t> indices, int vertexCount);
+
+// average cache miss ratio: transformed vertices per triangle (0.5 at best, 3 at worst)
+float computeAcmr(Span<const uint32_t> indices);
+
+// average transform to vertex ratio: transformed vertices per vertex (1 at best)
+float computeAtvr(Span<const uint32_t> indices, int vertexCount);
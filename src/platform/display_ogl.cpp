@@ -17,6 +17,7 @@
 #include "base/logger.h"
 #include "base/matrix4.h"
 #include "base/span.h"
+#include "engine/cooked_texture.h"
 #include "engine/graphics_backend.h"
 #include "misc/file.h"
 #include "misc/stats.h"
@@ -49,6 +50,7 @@ void ensureGl(char const* expr, const char* file, int line)
 namespace
 {
 Gauge ggDrawCalls("Draw calls");
+Gauge ggUniformBytes("Uniform bytes/frame");
 
 GLuint compileShader(Span<const uint8_t> code, int type)
 {
@@ -166,31 +168,66 @@ struct OpenGlTexture : ITexture
 
   void upload(PictureView pic) override
   {
-    glBindTexture(GL_TEXTURE_2D, texture);
-    SAFE_GL(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, pic.dim.x, pic.dim.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, pic.pixels));
-    SAFE_GL(glGenerateMipmap(GL_TEXTURE_2D));
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, 8);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    target = GL_TEXTURE_2D;
+    glBindTexture(target, texture);
+    SAFE_GL(glTexImage2D(target, 0, GL_RGBA, pic.dim.x, pic.dim.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, pic.pixels));
+    SAFE_GL(glGenerateMipmap(target));
+    setSamplingParameters();
+    glBindTexture(target, 0);
+  }
+
+  // cooked textures are always arrays, even with a single layer
+  void uploadMipChain(CookedTexture const& tex, int firstLevel) override
+  {
+    // a new texture object: the storage of the levels left out gets released
+    glDeleteTextures(1, &texture);
+    SAFE_GL(glGenTextures(1, &texture));
+
+    target = GL_TEXTURE_2D_ARRAY;
+    glBindTexture(target, texture);
+
+    auto texels = tex.texels.data;
+
+    for(int level = 0; level < tex.levelCount; ++level)
+    {
+      const auto dim = getMipLevelSize(tex.dim, level);
+
+      if(level >= firstLevel)
+        SAFE_GL(glTexImage3D(target, level, GL_RGBA, dim.x, dim.y, tex.layerCount, 0, GL_RGBA, GL_UNSIGNED_BYTE, texels));
+
+      texels += dim.x * dim.y * tex.layerCount * 4;
+    }
+
+    glTexParameteri(target, GL_TEXTURE_BASE_LEVEL, firstLevel);
+    glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, tex.levelCount - 1);
+    setSamplingParameters();
+    glBindTexture(target, 0);
+  }
+
+  void setSamplingParameters()
+  {
+    glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameterf(target, GL_TEXTURE_MAX_ANISOTROPY_EXT, 8);
   }
 
   void setNoRepeat() override
   {
-    glBindTexture(GL_TEXTURE_2D, texture);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(target, texture);
+    glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
   }
 
   void bind(int unit) override
   {
     SAFE_GL(glActiveTexture(GL_TEXTURE0 + unit));
-    SAFE_GL(glBindTexture(GL_TEXTURE_2D, texture));
+    SAFE_GL(glBindTexture(target, texture));
   }
 
   GLuint texture;
+  GLenum target = GL_TEXTURE_2D; // GL_TEXTURE_2D_ARRAY once a cooked texture is uploaded
 };
 
 struct OpenGlFrameBuffer : IFrameBuffer
@@ -264,10 +301,45 @@ struct OpenGlVertexBuffer : IVertexBuffer
     SAFE_GL(glBindBuffer(GL_ARRAY_BUFFER, 0));
   }
 
+  void update(size_t offset, const void* data, size_t len) override
+  {
+    SAFE_GL(glBindBuffer(GL_ARRAY_BUFFER, vbo));
+    SAFE_GL(glBufferSubData(GL_ARRAY_BUFFER, offset, len, data));
+    SAFE_GL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+  }
+
   GLuint vbo;
   const bool dynamic;
 };
 
+struct OpenGlIndexBuffer : IIndexBuffer
+{
+  OpenGlIndexBuffer()
+  {
+    SAFE_GL(glGenBuffers(1, &ibo));
+  }
+
+  ~OpenGlIndexBuffer()
+  {
+    glDeleteBuffers(1, &ibo);
+  }
+
+  void upload(const void* data, int indexCount, int indexSize) override
+  {
+    assert(indexSize == 2 || indexSize == 4);
+    type = indexSize == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    size = indexSize;
+
+    SAFE_GL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo));
+    SAFE_GL(glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * indexSize, data, GL_STATIC_DRAW));
+    SAFE_GL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
+  }
+
+  GLuint ibo;
+  GLenum type = GL_UNSIGNED_SHORT;
+  int size = 2;
+};
+
 struct OpenGlGraphicsBackend : IGraphicsBackend
 {
   OpenGlGraphicsBackend(Vec2i resolution)
@@ -318,8 +390,8 @@ struct OpenGlGraphicsBackend : IGraphicsBackend
     // Enable vsync
     SDL_GL_SetSwapInterval(1);
 
-    // Create our unique uniform buffer
-    SAFE_GL(glGenBuffers(1, &m_uniformBuffer));
+    // One uniform buffer per binding point
+    SAFE_GL(glGenBuffers(MaxUniformBindings, m_uniformBuffers));
 
     glEnable(GL_BLEND);
     glEnable(GL_CULL_FACE);
@@ -332,7 +404,7 @@ struct OpenGlGraphicsBackend : IGraphicsBackend
 
   ~OpenGlGraphicsBackend()
   {
-    SAFE_GL(glDeleteBuffers(1, &m_uniformBuffer));
+    SAFE_GL(glDeleteBuffers(MaxUniformBindings, m_uniformBuffers));
     SAFE_GL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
 
     SDL_GL_DeleteContext(m_context);
@@ -416,7 +488,14 @@ struct OpenGlGraphicsBackend : IGraphicsBackend
     SAFE_GL(glBindBuffer(GL_ARRAY_BUFFER, vb->vbo));
   }
 
-  void enableVertexAttribute(int id, int dim, int stride, int offset) override
+  void useIndexBuffer(IIndexBuffer* iib) override
+  {
+    auto ib = dynamic_cast<OpenGlIndexBuffer*>(iib);
+    SAFE_GL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ib->ibo));
+    m_currIndexBuffer = ib;
+  }
+
+  void enableVertexAttribute(int id, int dim, int stride, int offset, AttributeFormat format) override
   {
     if(dim == 0)
     {
@@ -424,16 +503,46 @@ struct OpenGlGraphicsBackend : IGraphicsBackend
     }
     else
     {
+      GLenum type = GL_FLOAT;
+      GLboolean normalized = GL_FALSE;
+
+      switch(format)
+      {
+      case AttributeFormat::Float:
+        break;
+      case AttributeFormat::Unorm16:
+        type = GL_UNSIGNED_SHORT;
+        normalized = GL_TRUE;
+        break;
+      case AttributeFormat::Snorm16:
+        type = GL_SHORT;
+        normalized = GL_TRUE;
+        break;
+      }
+
       SAFE_GL(glEnableVertexAttribArray(id));
-      SAFE_GL(glVertexAttribPointer(id, dim, GL_FLOAT, GL_FALSE, stride, (void*)(uintptr_t)offset));
+      SAFE_GL(glVertexAttribPointer(id, dim, type, normalized, stride, (void*)(uintptr_t)offset));
     }
+
+    SAFE_GL(glVertexAttribDivisor(id, 0));
+  }
+
+  void enableInstanceAttribute(int id, int dim, int stride, int offset) override
+  {
+    SAFE_GL(glEnableVertexAttribArray(id));
+    SAFE_GL(glVertexAttribPointer(id, dim, GL_FLOAT, GL_FALSE, stride, (void*)(uintptr_t)offset));
+    SAFE_GL(glVertexAttribDivisor(id, 1));
   }
 
-  void setUniformBlock(void* ptr, size_t size) override
+  void setUniformBlock(void* ptr, size_t size, int binding) override
   {
-    glBindBuffer(GL_UNIFORM_BUFFER, m_uniformBuffer);
+    assert(binding >= 0 && binding < MaxUniformBindings);
+
+    glBindBuffer(GL_UNIFORM_BUFFER, m_uniformBuffers[binding]);
     glBufferData(GL_UNIFORM_BUFFER, size, ptr, GL_DYNAMIC_DRAW);
-    glBindBufferBase(GL_UNIFORM_BUFFER, 0, m_uniformBuffer);
+    glBindBufferBase(GL_UNIFORM_BUFFER, binding, m_uniformBuffers[binding]);
+
+    m_uniformBytes += size;
   }
 
   std::unique_ptr<IVertexBuffer> createVertexBuffer(bool dynamic) override
@@ -441,6 +550,11 @@ struct OpenGlGraphicsBackend : IGraphicsBackend
     return std::make_unique<OpenGlVertexBuffer>(dynamic);
   }
 
+  std::unique_ptr<IIndexBuffer> createIndexBuffer() override
+  {
+    return std::make_unique<OpenGlIndexBuffer>();
+  }
+
   std::unique_ptr<IFrameBuffer> createFrameBuffer(Vec2i resolution, bool depth) override
   {
     return std::make_unique<OpenGlFrameBuffer>(resolution, depth);
@@ -471,9 +585,23 @@ struct OpenGlGraphicsBackend : IGraphicsBackend
       SAFE_GL(glDisable(GL_DEPTH_TEST));
   }
 
-  void draw(int vertexCount) override
+  void draw(int vertexCount, int firstVertex) override
+  {
+    SAFE_GL(glDrawArrays(GL_TRIANGLES, firstVertex, vertexCount));
+    ++m_drawCallCount;
+  }
+
+  void drawInstanced(int vertexCount, int instanceCount, int firstVertex) override
+  {
+    SAFE_GL(glDrawArraysInstanced(GL_TRIANGLES, firstVertex, vertexCount, instanceCount));
+    ++m_drawCallCount;
+  }
+
+  void drawIndexedInstanced(int indexCount, int instanceCount, int firstIndex) override
   {
-    SAFE_GL(glDrawArrays(GL_TRIANGLES, 0, vertexCount));
+    assert(m_currIndexBuffer);
+    auto offset = (void*)(uintptr_t)(firstIndex * m_currIndexBuffer->size);
+    SAFE_GL(glDrawElementsInstanced(GL_TRIANGLES, indexCount, m_currIndexBuffer->type, offset, instanceCount));
     ++m_drawCallCount;
   }
 
@@ -489,6 +617,8 @@ struct OpenGlGraphicsBackend : IGraphicsBackend
     updateScreenSize();
     ggDrawCalls = m_drawCallCount;
     m_drawCallCount = 0;
+    ggUniformBytes = m_uniformBytes;
+    m_uniformBytes = 0;
   }
 
   void updateScreenSize()
@@ -518,8 +648,11 @@ private:
   IScreenSizeListener* m_screenSizeListener {};
   SDL_Window* m_window;
   SDL_GLContext m_context;
-  GLuint m_uniformBuffer {};
+  static constexpr auto MaxUniformBindings = 3;
+  GLuint m_uniformBuffers[MaxUniformBindings] {};
+  int m_uniformBytes = 0;
   const OpenGlProgram* m_currProgram;
+  const OpenGlIndexBuffer* m_currIndexBuffer {};
 };
 }
 
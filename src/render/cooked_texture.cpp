@@ -0,0 +1,170 @@
+// Copyright (C) 2026 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+#include "engine/cooked_texture.h"
+#include "png.h"
+#include <algorithm> // max, min
+#include <stdexcept>
+#include <string.h> // memcpy
+
+namespace
+{
+const auto bpp = 4;
+
+// the texels follow immediately
+struct Header
+{
+  char magic[4];
+  int32_t width;
+  int32_t height;
+  int32_t layerCount;
+  int32_t levelCount;
+};
+
+const char Magic[4] = { 'T', 'E', 'X', '2' };
+
+// 2x2 box filter. The last row/column of odd sized levels is repeated.
+std::vector<uint8_t> downsample(const uint8_t* src, Vec2i srcDim, Vec2i dstDim)
+{
+  std::vector<uint8_t> dst(dstDim.x * dstDim.y * bpp);
+
+  for(int y = 0; y < dstDim.y; ++y)
+  {
+    const int y0 = std::min(y * 2, srcDim.y - 1);
+    const int y1 = std::min(y * 2 + 1, srcDim.y - 1);
+
+    for(int x = 0; x < dstDim.x; ++x)
+    {
+      const int x0 = std::min(x * 2, srcDim.x - 1);
+      const int x1 = std::min(x * 2 + 1, srcDim.x - 1);
+
+      for(int c = 0; c < bpp; ++c)
+      {
+        const int sum =
+          src[(x0 + y0 * srcDim.x) * bpp + c] +
+          src[(x1 + y0 * srcDim.x) * bpp + c] +
+          src[(x0 + y1 * srcDim.x) * bpp + c] +
+          src[(x1 + y1 * srcDim.x) * bpp + c];
+
+        dst[(x + y * dstDim.x) * bpp + c] = (sum + 2) / 4;
+      }
+    }
+  }
+
+  return dst;
+}
+}
+
+int getMipLevelCount(Vec2i dim)
+{
+  int count = 1;
+
+  while(dim.x > 1 || dim.y > 1)
+  {
+    dim = getMipLevelSize(dim, 1);
+    ++count;
+  }
+
+  return count;
+}
+
+Vec2i getMipLevelSize(Vec2i dim, int level)
+{
+  return Vec2i(std::max(1, dim.x >> level), std::max(1, dim.y >> level));
+}
+
+TextureImage decodeTextureImage(Span<const uint8_t> pngData)
+{
+  TextureImage r;
+  r.pixels = decodePng(pngData, r.dim.x, r.dim.y);
+  return r;
+}
+
+std::vector<uint8_t> cookTexture(Span<const TextureImage> layers)
+{
+  if(layers.len == 0)
+    throw std::runtime_error("Texture with no layers");
+
+  const auto dim = layers[0].dim;
+
+  for(auto& layer : layers)
+  {
+    if(layer.dim.x != dim.x || layer.dim.y != dim.y)
+      throw std::runtime_error("Texture layers of different sizes");
+  }
+
+  Header header;
+  memcpy(header.magic, Magic, sizeof Magic);
+  header.width = dim.x;
+  header.height = dim.y;
+  header.layerCount = layers.len;
+  header.levelCount = getMipLevelCount(dim);
+
+  std::vector<uint8_t> r(sizeof header);
+  memcpy(r.data(), &header, sizeof header);
+
+  // level 0: bottom row first
+  std::vector<std::vector<uint8_t>> levels;
+  const int rowSize = dim.x * bpp;
+
+  for(auto& layer : layers)
+  {
+    std::vector<uint8_t> level;
+
+    for(int y = dim.y - 1; y >= 0; --y)
+      level.insert(level.end(), &layer.pixels[y * rowSize], &layer.pixels[y * rowSize] + rowSize);
+
+    r.insert(r.end(), level.begin(), level.end());
+    levels.push_back(std::move(level));
+  }
+
+  for(int i = 1; i < header.levelCount; ++i)
+  {
+    for(auto& level : levels)
+    {
+      level = downsample(level.data(), getMipLevelSize(dim, i - 1), getMipLevelSize(dim, i));
+      r.insert(r.end(), level.begin(), level.end());
+    }
+  }
+
+  return r;
+}
+
+CookedTexture parseCookedTexture(Span<const uint8_t> data)
+{
+  Header header;
+
+  if(data.len < (int)sizeof header)
+    throw std::runtime_error("Truncated texture");
+
+  memcpy(&header, data.data, sizeof header);
+
+  if(memcmp(header.magic, Magic, sizeof Magic))
+    throw std::runtime_error("Not a cooked texture");
+
+  CookedTexture r;
+  r.dim = Vec2i(header.width, header.height);
+  r.layerCount = header.layerCount;
+  r.levelCount = header.levelCount;
+
+  if(r.dim.x <= 0 || r.dim.y <= 0 || r.layerCount <= 0 || r.levelCount <= 0 || r.levelCount > getMipLevelCount(r.dim))
+    throw std::runtime_error("Invalid texture size");
+
+  int64_t size = 0;
+
+  for(int i = 0; i < r.levelCount; ++i)
+  {
+    const auto levelDim = getMipLevelSize(r.dim, i);
+    size += int64_t(levelDim.x) * levelDim.y * bpp * r.layerCount;
+  }
+
+  if(size != data.len - (int)sizeof header)
+    throw std::runtime_error("Truncated texture");
+
+  r.texels = Span<const uint8_t>(data.data + sizeof header, (int)size);
+
+  return r;
+}
@@ -0,0 +1,48 @@
+// Copyright (C) 2026 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+// View-frustum culling
+
+#pragma once
+
+#include "base/geom.h"
+#include "base/matrix4.h"
+
+// Returns true if the box is entirely outside the view frustum.
+// 'MVP' maps the box coordinates to clip space.
+// Conservative: a box crossing several planes might be kept.
+inline
+bool isOutsideFrustum(Matrix4f const& MVP, Vec3f boxMin, Vec3f boxMax)
+{
+  // for each clip plane (-x, +x, -y, +y, -z, +z), the number of corners outside
+  int outside[6] {};
+
+  for(int i = 0; i < 8; ++i)
+  {
+    const Vec4f corner =
+    {
+      (i & 1) ? boxMax.x : boxMin.x,
+      (i & 2) ? boxMax.y : boxMin.y,
+      (i & 4) ? boxMax.z : boxMin.z,
+      1,
+    };
+
+    const auto p = MVP * corner;
+
+    outside[0] += p.x < -p.w;
+    outside[1] += p.x > p.w;
+    outside[2] += p.y < -p.w;
+    outside[3] += p.y > p.w;
+    outside[4] += p.z < -p.w;
+    outside[5] += p.z > p.w;
+  }
+
+  for(auto count : outside)
+    if(count == 8)
+      return true;
+
+  return false;
+}
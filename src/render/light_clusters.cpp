@@ -0,0 +1,124 @@
+// Copyright (C) 2026 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+#include "light_clusters.h"
+
+#include <algorithm> // min, max
+#include <cmath> // floor, log, pow
+
+namespace
+{
+// Range of tiles overlapped by the coordinates [lo;hi], seen from the depths [near;far]
+bool getTileRange(float lo, float hi, float near, float far, float tanHalfFov, int size, int& first, int& last)
+{
+  // the widest projection of each bound
+  const float ndcLo = lo / ((lo < 0 ? near : far) * tanHalfFov);
+  const float ndcHi = hi / ((hi > 0 ? near : far) * tanHalfFov);
+
+  if(ndcHi < -1 || ndcLo > 1)
+    return false;
+
+  first = std::max(0, (int)std::floor((ndcLo * 0.5f + 0.5f) * size));
+  last = std::min(size - 1, (int)std::floor((ndcHi * 0.5f + 0.5f) * size));
+
+  return true;
+}
+
+float getSliceStart(int slice)
+{
+  if(slice == 0)
+    return 0;
+
+  return LightClusters::NearDepth * std::pow(LightClusters::FarDepth / LightClusters::NearDepth, float(slice) / LightClusters::SizeZ);
+}
+}
+
+int LightClusters::getSlice(float depth)
+{
+  if(depth <= NearDepth)
+    return 0;
+
+  const int slice = (int)std::floor(std::log(depth / NearDepth) / std::log(FarDepth / NearDepth) * SizeZ);
+
+  return std::min(slice, SizeZ - 1);
+}
+
+void LightClusters::begin(float tanHalfFovX, float tanHalfFovY)
+{
+  m_tanHalfFovX = tanHalfFovX;
+  m_tanHalfFovY = tanHalfFovY;
+  m_lightCount = 0;
+  m_entries.clear();
+}
+
+bool LightClusters::addLight(Vec3f pos, float radius)
+{
+  if(m_lightCount >= MaxLights)
+    return false;
+
+  const float depth = -pos.z;
+  const float minDepth = std::max(depth - radius, NearDepth);
+  const float maxDepth = depth + radius;
+
+  if(maxDepth < NearDepth)
+    return false;
+
+  const auto entryCount = m_entries.size();
+
+  for(int z = getSlice(minDepth); z <= getSlice(maxDepth); ++z)
+  {
+    // the part of the slice the sphere overlaps
+    const float near = std::max(minDepth, getSliceStart(z));
+    const float far = z == SizeZ - 1 ? maxDepth : std::min(maxDepth, getSliceStart(z + 1));
+
+    int x0, x1, y0, y1;
+
+    if(!getTileRange(pos.x - radius, pos.x + radius, near, far, m_tanHalfFovX, SizeX, x0, x1))
+      continue;
+
+    if(!getTileRange(pos.y - radius, pos.y + radius, near, far, m_tanHalfFovY, SizeY, y0, y1))
+      continue;
+
+    for(int y = y0; y <= y1; ++y)
+      for(int x = x0; x <= x1; ++x)
+        m_entries.push_back({ getClusterIndex(x, y, z), m_lightCount });
+  }
+
+  if(m_entries.size() == entryCount)
+    return false;
+
+  ++m_lightCount;
+  return true;
+}
+
+void LightClusters::end()
+{
+  for(auto& count : m_counts)
+    count = 0;
+
+  for(auto& entry : m_entries)
+    ++m_counts[entry.cluster];
+
+  // the lights of each cluster are contiguous
+  int first = 0;
+
+  for(int i = 0; i < ClusterCount; ++i)
+  {
+    const int count = std::min(m_counts[i], MaxIndices - first);
+    uniforms.ranges[i] = first | (count << 16);
+    m_counts[i] = first; // from now on: where the next light of the cluster goes
+    first += count;
+  }
+
+  for(auto& entry : m_entries)
+  {
+    const auto range = uniforms.ranges[entry.cluster];
+    const int end = (range & 0xFFFF) + (range >> 16);
+
+    if(m_counts[entry.cluster] < end)
+      uniforms.indices[m_counts[entry.cluster]++] = entry.light;
+  }
+}
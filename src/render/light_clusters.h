@@ -0,0 +1,72 @@
+// Copyright (C) 2026 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+// Clustered light culling.
+// The view frustum is split into a grid of cells ('clusters'): tiles on the
+// screen, and slices in depth, thicker with the distance. Each light only
+// goes to the clusters its sphere of influence overlaps, so a fragment only
+// goes through the lights of its cluster.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "base/geom.h"
+
+struct LightClusters
+{
+  // Must match mesh.frag
+  static constexpr int SizeX = 8;
+  static constexpr int SizeY = 4;
+  static constexpr int SizeZ = 16;
+  static constexpr int ClusterCount = SizeX * SizeY * SizeZ;
+  static constexpr float NearDepth = 0.1f;
+  static constexpr float FarDepth = 100.0f; // the last slice goes on to infinity
+
+  static constexpr int MaxLights = 256; // the light indices are 8 bits
+  static constexpr int MaxIndices = 12 * 1024;
+
+  // Must match the uniform block 'LightClusters' in mesh.frag
+  struct Uniforms
+  {
+    uint32_t ranges[ClusterCount]; // per cluster: first index (low 16 bits), light count (high 16 bits)
+    uint8_t indices[MaxIndices];
+  };
+
+  // Slopes of the sides of the view frustum
+  void begin(float tanHalfFovX, float tanHalfFovY);
+
+  // Assigns the next light index to the clusters overlapped by the sphere.
+  // 'pos' is in view space, the camera looking towards -z.
+  // Returns false if no cluster is overlapped, or if there's no index left: the light can be skipped.
+  bool addLight(Vec3f pos, float radius);
+
+  // Fills 'uniforms' with the lights added since 'begin'.
+  // When a frame has too many light indices, the last clusters lose some of their lights.
+  void end();
+
+  int getLightCount() const { return m_lightCount; }
+
+  static int getSlice(float depth);
+  static int getClusterIndex(int x, int y, int z) { return (z * SizeY + y) * SizeX + x; }
+
+  Uniforms uniforms {};
+
+private:
+  float m_tanHalfFovX = 1;
+  float m_tanHalfFovY = 1;
+  int m_lightCount = 0;
+
+  struct Entry
+  {
+    int cluster;
+    int light;
+  };
+
+  std::vector<Entry> m_entries; // in light order
+  int m_counts[ClusterCount];
+};
@@ -22,39 +22,17 @@ void applyTransforms(ImportedScene& scene)
   {
     const auto normalTransform = transpose(invertStandardMatrix(model.transform));
 
-    for(auto& v : model.vertices)
-    {
-      {
-        Vec4f vert = { v.x, v.y, v.z, 1 };
-        vert = model.transform * vert;
+    if(model.vertices.empty())
+      continue;
 
-        v.x = vert.x;
-        v.y = vert.y;
-        v.z = vert.z;
-      }
+    auto& first = model.vertices[0];
+    const int count = model.vertices.size();
+    const int stride = sizeof first;
 
-      {
-        Vec4f normal = { v.nx, v.ny, v.nz, 0 };
-        Vec4f binormal = { v.bx, v.by, v.bz, 0 };
-        Vec4f tangent = { v.tx, v.ty, v.tz, 0 };
-
-        normal = normalTransform * normal;
-        binormal = normalTransform * binormal;
-        tangent = normalTransform * tangent;
-
-        v.nx = normal.x;
-        v.ny = normal.y;
-        v.nz = normal.z;
-
-        v.bx = binormal.x;
-        v.by = binormal.y;
-        v.bz = binormal.z;
-
-        v.tx = tangent.x;
-        v.ty = tangent.y;
-        v.tz = tangent.z;
-      }
-    }
+    transformPoints(model.transform, &first.x, count, stride);
+    transformDirections(normalTransform, &first.nx, count, stride);
+    transformDirections(normalTransform, &first.bx, count, stride);
+    transformDirections(normalTransform, &first.tx, count, stride);
   }
 }
 
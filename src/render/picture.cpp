@@ -1,3 +1,4 @@
+#include "base/error.h"
 #include "misc/file.h"
 #include "picture.h"
 #include "png.h"
@@ -20,6 +21,29 @@ void blit(PictureView dst, Vec2i dstPos, PictureView src, Vec2i srcPos, Vec2i si
 }
 }
 
+Picture generatedPicture()
+{
+  printf("[display] falling back on generated texture\n");
+
+  Picture r {};
+  r.dim = Vec2i(32, 32);
+  r.stride = r.dim.x;
+  r.pixels.resize(r.dim.x * r.dim.y * 4);
+
+  for(int y = 0; y < r.dim.y; ++y)
+  {
+    for(int x = 0; x < r.dim.x; ++x)
+    {
+      r.pixels[(x + y * r.dim.x) * 4 + 0] = 0xff;
+      r.pixels[(x + y * r.dim.x) * 4 + 1] = x < 16 ? 0xff : 0x00;
+      r.pixels[(x + y * r.dim.x) * 4 + 2] = y < 16 ? 0xff : 0x00;
+      r.pixels[(x + y * r.dim.x) * 4 + 3] = 0xff;
+    }
+  }
+
+  return r;
+}
+
 Picture addBorderToTiles(PictureView src, int cols, int rows)
 {
   const int border = 1;
@@ -87,24 +111,14 @@ Picture loadPicture(String path)
   catch(std::exception const& e)
   {
     printf("[display] can't load texture '%.*s' (%s)\n", path.len, path.data, e.what());
-    printf("[display] falling back on generated texture\n");
-
-    Picture r {};
-    r.dim = Vec2i(32, 32);
-    r.pixels.resize(r.dim.x * r.dim.y * 4);
-
-    for(int y = 0; y < r.dim.y; ++y)
-    {
-      for(int x = 0; x < r.dim.x; ++x)
-      {
-        r.pixels[(x + y * r.dim.x) * 4 + 0] = 0xff;
-        r.pixels[(x + y * r.dim.x) * 4 + 1] = x < 16 ? 0xff : 0x00;
-        r.pixels[(x + y * r.dim.x) * 4 + 2] = y < 16 ? 0xff : 0x00;
-        r.pixels[(x + y * r.dim.x) * 4 + 3] = 0xff;
-      }
-    }
-
-    return r;
+    return generatedPicture();
+  }
+  catch(Error const& e)
+  {
+    // e.g missing file
+    const auto msg = e.message();
+    printf("[display] can't load texture '%.*s' (%.*s)\n", path.len, path.data, msg.len, msg.data);
+    return generatedPicture();
   }
 }
 
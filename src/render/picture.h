@@ -28,3 +28,6 @@ struct Picture
 Picture addBorderToTiles(PictureView src, int cols, int rows);
 Picture loadPicture(String path);
 
+// fallback for the textures that can't be loaded
+Picture generatedPicture();
+
@@ -7,34 +7,61 @@
 ///////////////////////////////////////////////////////////////////////////////
 // High-level renderer
 
-#include <algorithm> // sort
+#include <algorithm> // min, max
 #include <chrono>
+#include <cmath> // sqrt, tan
 #include <cstring>
+#include <exception>
+#include <map>
 #include <memory>
 #include <vector>
 
+#include "base/error.h"
 #include "base/geom.h"
 #include "base/matrix4.h"
 #include "base/scene.h"
 #include "base/span.h"
-#include "base/util.h" // setExtension
+#include "base/util.h" // setExtension, endsWith
+#include "base/view.h" // getLightRange
 #include "engine/graphics_backend.h"
 #include "engine/renderer.h"
 #include "engine/rendermesh.h"
+#include "misc/job_queue.h"
+#include "misc/pvs.h"
+#include "misc/radix_sort.h"
+#include "misc/resource_cache.h"
 #include "misc/stats.h"
 #include "misc/time.h"
 
+#include "frustum.h"
+#include "light_clusters.h"
 #include "picture.h"
 #include "postprocess.h"
 #include "renderer_quads.h"
 #include "renderpass.h"
-#include "weakcache.h"
+#include "sort_key.h"
+#include "texture_streaming.h"
 
 std::unique_ptr<RenderPass> CreateSkyboxPass(IGraphicsBackend* backend, const Camera* camera);
 
 namespace
 {
 Gauge ggRenderTime("Render time (ms)");
+Gauge ggChunksSubmitted("Mesh chunks submitted");
+Gauge ggChunksDrawn("Mesh chunks drawn");
+Gauge ggChunksHidden("Mesh chunks hidden by PVS");
+Gauge ggTrianglesDrawn("Triangles drawn");
+Gauge ggMeshDrawCalls("Mesh draw calls");
+Gauge ggLightsDrawn("Lights drawn");
+Gauge ggTextureCacheMegabytes("Texture cache (MB)");
+Gauge ggTextureCacheHits("Texture cache hits");
+Gauge ggTextureCacheMisses("Texture cache misses");
+Gauge ggTextureCacheEvictions("Texture cache evictions");
+Gauge ggMeshCacheMegabytes("Mesh cache (MB)");
+Gauge ggMeshCacheHits("Mesh cache hits");
+Gauge ggMeshCacheMisses("Mesh cache misses");
+Gauge ggMeshCacheEvictions("Mesh cache evictions");
+Gauge ggLoadsPending("Resource loads pending");
 
 template<typename T>
 T blend(T a, T b, float alpha)
@@ -45,13 +72,38 @@ T blend(T a, T b, float alpha)
 const int COLS = 16;
 const int ROWS = 16;
 
-struct DrawCommand
+const char FontPath[] = "res/font.png";
+
+// Reading and decoding the resources
+const int LoaderThreads = 2;
+
+// GPU uploads of the resources loaded in the background, per frame
+const int64_t UploadBudgetUs = 4000;
+
+const float FovY = (float)((60.0f / 180) * PI);
+const float NearPlane = 0.1f;
+
+// Where an actor is drawn. Shared by all the draw commands of the actor.
+struct Transform
 {
-  SingleRenderMesh* pMesh;
   Rect3f where;
   Quaternion orientation;
-  Camera camera;
+};
+
+struct DrawCommand
+{
+  SingleRenderMesh* pMesh;
+  int transform; // index in 'm_transforms' and 'm_modelMatrices'
   bool blinking;
+
+  // range of visible chunks of 'pMesh'
+  int firstChunk;
+  int chunkCount;
+  int lod; // 0: full detail
+
+  const Pvs* pvs; // can be null
+
+  uint64_t sortKey; // see sort_key.h
 };
 
 struct MeshRenderPass
@@ -60,44 +112,329 @@ struct MeshRenderPass
   {
     backend->setRenderTarget(dst.fb);
 
-    auto byMaterial = [] (const DrawCommand& a, const DrawCommand& b)
-      {
-        if(a.pMesh->transparency != b.pMesh->transparency)
-          return a.pMesh->transparency < b.pMesh->transparency;
+    // the same for all the commands of the frame
+    m_viewProjection = getViewProjection(*m_camera);
 
-        return false;
-      };
+    computeModelMatrices();
+    cullDrawCommands();
 
-    std::sort(m_drawCommands.begin(), m_drawCommands.end(), byMaterial);
+    sortDrawCommands();
+
+    // per-instance data, for all the draw commands of this frame
+    m_instances.clear();
 
     for(auto& cmd : m_drawCommands)
-      executeDrawCommand(cmd);
+      m_instances.push_back(transpose(m_modelMatrices[cmd.transform]));
+
+    if(m_instances.size())
+      m_instanceBuffer->upload(m_instances.data(), m_instances.size() * sizeof(m_instances[0]));
+
+    if(m_drawCommands.size())
+    {
+      backend->useGpuProgram(m_meshShader.get());
+      uploadFrameUniforms();
+    }
+
+    int drawCalls = 0;
+
+    for(int i = 0; i < (int)m_drawCommands.size();)
+    {
+      int count = 1;
+
+      while(i + count < (int)m_drawCommands.size() && canBeInstanced(m_drawCommands[i], m_drawCommands[i + count]))
+        ++count;
+
+      executeDrawCommand(m_drawCommands[i], i, count);
+      ++drawCalls;
+
+      i += count;
+    }
+
+    ggMeshDrawCalls = drawCalls;
 
     backend->enableVertexAttribute(MeshShader::Attribute::positionLoc, 0, 0, 0);
     backend->enableVertexAttribute(MeshShader::Attribute::normalLoc, 0, 0, 0);
-    backend->enableVertexAttribute(MeshShader::Attribute::binormalLoc, 0, 0, 0);
     backend->enableVertexAttribute(MeshShader::Attribute::tangentLoc, 0, 0, 0);
     backend->enableVertexAttribute(MeshShader::Attribute::uvDiffuseLoc, 0, 0, 0);
+
+    for(int k = 0; k < 4; ++k)
+      backend->enableVertexAttribute(MeshShader::Attribute::modelMatrixLoc + k, 0, 0, 0);
   }
 
-  void executeDrawCommand(const DrawCommand& cmd)
+  // Commands drawing the same vertices, with the same uniforms
+  static bool canBeInstanced(const DrawCommand& a, const DrawCommand& b)
   {
-    auto& model = *cmd.pMesh;
-    auto& where = cmd.where;
+    return a.pMesh == b.pMesh
+           && a.firstChunk == b.firstChunk
+           && a.chunkCount == b.chunkCount
+           && a.lod == b.lod
+           && a.blinking == b.blinking;
+  }
 
-    backend->useGpuProgram(m_meshShader.get());
+  void computeModelMatrices()
+  {
+    m_modelMatrices.resize(m_transforms.size());
+
+    for(int i = 0; i < (int)m_transforms.size(); ++i)
+      m_modelMatrices[i] = getModelMatrix(m_transforms[i]);
+  }
+
+  // Groups the commands by state, so the ones that can be instanced together
+  // end up next to each other. Opaque ones go front to back, translucent ones back to front.
+  void sortDrawCommands()
+  {
+    m_sortEntries.clear();
 
-    // Must match the uniform block in mesh.frag and mesh.vert
-    struct MyUniformBlock
+    for(auto& cmd : m_drawCommands)
     {
-      Matrix4f M;
-      Matrix4f MVP;
-      Vec4f fragOffset;
+      auto& chunks = cmd.pMesh->chunks;
+      Vec3f boundsMin = chunks[cmd.firstChunk].boundsMin;
+      Vec3f boundsMax = chunks[cmd.firstChunk].boundsMax;
+
+      for(int i = cmd.firstChunk + 1; i < cmd.firstChunk + cmd.chunkCount; ++i)
+      {
+        boundsMin = Vec3f(std::min(boundsMin.x, chunks[i].boundsMin.x), std::min(boundsMin.y, chunks[i].boundsMin.y), std::min(boundsMin.z, chunks[i].boundsMin.z));
+        boundsMax = Vec3f(std::max(boundsMax.x, chunks[i].boundsMax.x), std::max(boundsMax.y, chunks[i].boundsMax.y), std::max(boundsMax.z, chunks[i].boundsMax.z));
+      }
+
+      const auto center = (boundsMin + boundsMax) * 0.5;
+      const auto worldCenter = m_modelMatrices[cmd.transform] * Vec4f { center.x, center.y, center.z, 1 };
+      const auto toCamera = Vec3f(worldCenter.x, worldCenter.y, worldCenter.z) - m_camera->pos;
+
+      SortKeyFields fields;
+      fields.translucent = cmd.pMesh->transparency;
+      fields.textureSet = cmd.pMesh->textureSetId;
+      fields.mesh = cmd.pMesh->meshId;
+      fields.blinking = cmd.blinking;
+      fields.firstChunk = cmd.firstChunk;
+      fields.chunkCount = cmd.chunkCount;
+      fields.lod = cmd.lod;
+      fields.depth = sqrt(dotProduct(toCamera, toCamera));
+
+      cmd.sortKey = makeSortKey(fields);
+      m_sortEntries.push_back({ cmd.sortKey, int(&cmd - m_drawCommands.data()) });
+    }
+
+    m_sortScratch.resize(m_sortEntries.size());
+    radixSort(m_sortEntries, m_sortScratch);
+
+    m_visibleCommands.clear();
+
+    for(auto& entry : m_sortEntries)
+      m_visibleCommands.push_back(m_drawCommands[entry.index]);
+
+    std::swap(m_drawCommands, m_visibleCommands);
+  }
+
+  // Drops what the camera can't see, before sorting.
+  // Meshes are culled chunk by chunk, consecutive visible chunks are drawn together.
+  void cullDrawCommands()
+  {
+    int submitted = 0;
+    int drawn = 0;
+    int hidden = 0;
+    int triangles = 0;
+
+    m_visibleCommands.clear();
+    m_textureUsage.clear();
+
+    for(auto& cmd : m_drawCommands)
+    {
+      const auto MVP = m_viewProjection * m_modelMatrices[cmd.transform];
+      auto& chunks = cmd.pMesh->chunks;
+
+      // cell of the camera, in model space (rooms are never rotated)
+      int cameraCell = -1;
+
+      if(cmd.pvs)
+      {
+        auto const& where = m_transforms[cmd.transform].where;
+        auto const pos = m_camera->pos - where.pos;
+        cameraCell = cmd.pvs->getCell(Vec3f(pos.x / where.size.x, pos.y / where.size.y, pos.z / where.size.z));
+      }
+
+      DrawCommand visible = cmd;
+      visible.chunkCount = 0;
+
+      // closest view of the mesh, for the texture streaming
+      float maxPixelsPerUnit = 0;
+
+      auto flush = [&] ()
+        {
+          if(visible.chunkCount > 0)
+            m_visibleCommands.push_back(visible);
+
+          visible.chunkCount = 0;
+        };
+
+      for(int i = cmd.firstChunk; i < cmd.firstChunk + cmd.chunkCount; ++i)
+      {
+        ++submitted;
+
+        if(cameraCell >= 0 && !cmd.pvs->isBoxVisible(cameraCell, chunks[i].boundsMin, chunks[i].boundsMax))
+        {
+          ++hidden;
+          flush();
+          continue;
+        }
+
+        if(isOutsideFrustum(MVP, chunks[i].boundsMin, chunks[i].boundsMax))
+        {
+          flush();
+          continue;
+        }
+
+        const float pixelsPerUnit = getPixelsPerUnit(chunks[i], cmd.transform);
+        const int lod = selectLod(*cmd.pMesh, pixelsPerUnit);
+        maxPixelsPerUnit = std::max(maxPixelsPerUnit, pixelsPerUnit);
+
+        if(visible.chunkCount > 0 && visible.lod != lod)
+          flush();
+
+        if(visible.chunkCount == 0)
+        {
+          visible.firstChunk = i;
+          visible.lod = lod;
+        }
+
+        ++visible.chunkCount;
+        ++drawn;
+        triangles += cmd.pMesh->getIndexRange(lod, i).count / 3;
+      }
+
+      flush();
+
+      if(maxPixelsPerUnit > 0)
+        m_textureUsage.push_back({ cmd.pMesh, maxPixelsPerUnit });
+    }
+
+    std::swap(m_drawCommands, m_visibleCommands);
+
+    ggChunksSubmitted = submitted;
+    ggChunksDrawn = drawn;
+    ggChunksHidden = hidden;
+    ggTrianglesDrawn = triangles;
+  }
+
+  // Size of one model space unit, projected on the screen, in pixels.
+  // Taken at the point of the bounding sphere of the chunk closest to the camera.
+  float getPixelsPerUnit(SingleRenderMesh::Chunk const& bounds, int transform) const
+  {
+    auto const& size = m_transforms[transform].where.size;
+    const float scale = std::max(size.x, std::max(size.y, size.z));
+
+    const auto center = (bounds.boundsMin + bounds.boundsMax) * 0.5;
+    const auto worldCenter = m_modelMatrices[transform] * Vec4f { center.x, center.y, center.z, 1 };
+    const auto toCamera = Vec3f(worldCenter.x, worldCenter.y, worldCenter.z) - m_camera->pos;
+    const auto radius = magnitude(bounds.boundsMax - bounds.boundsMin) * 0.5 * scale;
+    const auto distance = std::max(magnitude(toCamera) - radius, (double)NearPlane);
+
+    return scale * m_screenHeight / (2 * tan(FovY / 2) * distance);
+  }
+
+  // Coarsest LOD of the chunk whose simplification error,
+  // once projected on the screen, stays under 'm_lodBias' pixels.
+  int selectLod(SingleRenderMesh const& mesh, float pixelsPerUnit) const
+  {
+    int lod = 0;
+
+    while(lod < (int)mesh.lods.size() && mesh.lods[lod].error * pixelsPerUnit <= m_lodBias)
+      ++lod;
+
+    return lod;
+  }
+
+  static Matrix4f getView(const Camera& camera)
+  {
+    auto const forward = camera.dir.rotate(Vec3f(1, 0, 0));
+    auto const up = camera.dir.rotate(Vec3f(0, 0, 1));
+
+    auto const target = camera.pos + forward;
+    return ::lookAt(camera.pos, target, up);
+  }
+
+  Matrix4f getViewProjection(const Camera& camera) const
+  {
+    auto const view = getView(camera);
+
+    static const float far_ = 1000.0f;
+    const auto perspective = ::perspective(FovY, m_aspectRatio, NearPlane, far_);
+
+    return perspective * view;
+  }
+
+  static Matrix4f getModelMatrix(const Transform& transform)
+  {
+    auto const pos = ::translate(transform.where.pos);
+    auto const scale = ::scale(transform.where.size);
+    auto const rotate = quaternionToMatrix(transform.orientation);
+
+    return pos * rotate * scale;
+  }
+
+  // What doesn't change during the frame.
+  // Must match the uniform block 'FrameUniforms' in mesh.frag and mesh.vert
+  void uploadFrameUniforms()
+  {
+    struct FrameUniforms
+    {
+      Matrix4f VP;
       Vec4f cameraPos;
       Vec4f ambientLight;
-      Vec4f lightPos[32];
-      Vec4f lightColor[32];
-      int lightCount;
+      Vec4f lightPos[LightClusters::MaxLights]; // w: attenuation bias
+      Vec4f lightColor[LightClusters::MaxLights];
+    };
+
+    FrameUniforms ub {};
+    ub.ambientLight = { m_ambientLight, m_ambientLight, m_ambientLight, 0 };
+
+    // only the lights reaching the view frustum go to the GPU
+    const auto view = getView(*m_camera);
+    const float tanHalfFovY = tan(FovY / 2);
+
+    m_lightClusters.begin(tanHalfFovY * m_aspectRatio, tanHalfFovY);
+
+    for(auto& light : m_lights)
+    {
+      const float intensity = std::max(light.color.x, std::max(light.color.y, light.color.z));
+
+      if(intensity <= 0)
+        continue;
+
+      const float radius = getLightRange(intensity);
+      const auto viewPos = view * Vec4f { light.pos.x, light.pos.y, light.pos.z, 1 };
+      const int i = m_lightClusters.getLightCount();
+
+      if(!m_lightClusters.addLight(Vec3f(viewPos.x, viewPos.y, viewPos.z), radius))
+        continue;
+
+      ub.lightPos[i] = { light.pos.x, light.pos.y, light.pos.z, LightCutoff / intensity };
+      ub.lightColor[i] = { light.color.x, light.color.y, light.color.z, 1 };
+    }
+
+    m_lightClusters.end();
+    ggLightsDrawn = m_lightClusters.getLightCount();
+
+    ub.VP = transpose(m_viewProjection);
+    ub.cameraPos = { m_camera->pos.x, m_camera->pos.y, m_camera->pos.z, 1 };
+
+    backend->setUniformBlock(&ub, sizeof ub, 0);
+    backend->setUniformBlock(&m_lightClusters.uniforms, sizeof m_lightClusters.uniforms, 2);
+  }
+
+  // Draws 'instanceCount' instances of 'cmd', using the per-instance data starting at 'firstInstance'
+  void executeDrawCommand(const DrawCommand& cmd, int firstInstance, int instanceCount)
+  {
+    auto& model = *cmd.pMesh;
+
+    // Must match the uniform block 'DrawUniforms' in mesh.vert and mesh.frag
+    struct DrawUniforms
+    {
+      Vec4f fragOffset;
+      Vec4f positionOffset;
+      Vec4f positionScale;
+      Vec4f uvOffsetScale; // xy: offset, zw: scale
+      Vec4f textureLayer; // x: layer of the texture arrays
     };
 
     // Binding #1: Diffuse
@@ -109,36 +446,14 @@ struct MeshRenderPass
     // Binding #3: Emissive
     model.emissive->bind(3);
 
-    auto const forward = cmd.camera.dir.rotate(Vec3f(1, 0, 0));
-    auto const up = cmd.camera.dir.rotate(Vec3f(0, 0, 1));
-
-    auto const target = cmd.camera.pos + forward;
-    auto const view = ::lookAt(cmd.camera.pos, target, up);
-    auto const pos = ::translate(where.pos);
-    auto const scale = ::scale(where.size);
-    auto const rotate = quaternionToMatrix(cmd.orientation);
-
-    static const float fovy = (float)((60.0f / 180) * PI);
-    static const float near_ = 0.1f;
-    static const float far_ = 1000.0f;
-    const auto perspective = ::perspective(fovy, m_aspectRatio, near_, far_);
-
-    const auto MV = pos * rotate * scale;
-    const auto MVP = perspective * view * MV;
-
     {
-      MyUniformBlock ub {};
-      ub.ambientLight = { m_ambientLight, m_ambientLight, m_ambientLight, 0 };
-      ub.lightCount = m_lights.size();
+      auto& q = model.quantization;
 
-      assert(m_lights.size() < 32);
-
-      for(auto& light : m_lights)
-      {
-        const auto i = int(&light - m_lights.data());
-        ub.lightPos[i] = { light.pos.x, light.pos.y, light.pos.z, 1 };
-        ub.lightColor[i] = { light.color.x, light.color.y, light.color.z, 1 };
-      }
+      DrawUniforms ub {};
+      ub.positionOffset = { q.positionOffset.x, q.positionOffset.y, q.positionOffset.z, 0 };
+      ub.positionScale = { q.positionScale.x, q.positionScale.y, q.positionScale.z, 0 };
+      ub.uvOffsetScale = { q.uvOffset.x, q.uvOffset.y, q.uvScale.x, q.uvScale.y };
+      ub.textureLayer = { float(model.textureLayer), 0, 0, 0 };
 
       if(cmd.blinking)
       {
@@ -148,22 +463,29 @@ struct MeshRenderPass
         }
       }
 
-      ub.M = transpose(MV);
-      ub.MVP = transpose(MVP);
-      ub.cameraPos = { cmd.camera.pos.x, cmd.camera.pos.y, cmd.camera.pos.z, 1 };
-
-      backend->setUniformBlock(&ub, sizeof ub);
+      backend->setUniformBlock(&ub, sizeof ub, 1);
     }
 
+    // per-instance model matrix: one column per attribute
+    backend->useVertexBuffer(m_instanceBuffer.get());
+
+    for(int k = 0; k < 4; ++k)
+      backend->enableInstanceAttribute(MeshShader::Attribute::modelMatrixLoc + k, 4, sizeof(Matrix4f), (firstInstance * 4 + k) * sizeof(Matrix4f::row));
+
     backend->useVertexBuffer(model.vb.get());
+    backend->useIndexBuffer(model.ib.get());
 
-    backend->enableVertexAttribute(MeshShader::Attribute::positionLoc, 3, sizeof(SingleRenderMesh::Vertex), offsetof(SingleRenderMesh::Vertex, x));
-    backend->enableVertexAttribute(MeshShader::Attribute::normalLoc, 3, sizeof(SingleRenderMesh::Vertex), offsetof(SingleRenderMesh::Vertex, nx));
-    backend->enableVertexAttribute(MeshShader::Attribute::binormalLoc, 3, sizeof(SingleRenderMesh::Vertex), offsetof(SingleRenderMesh::Vertex, bx));
-    backend->enableVertexAttribute(MeshShader::Attribute::tangentLoc, 3, sizeof(SingleRenderMesh::Vertex), offsetof(SingleRenderMesh::Vertex, tx));
-    backend->enableVertexAttribute(MeshShader::Attribute::uvDiffuseLoc, 2, sizeof(SingleRenderMesh::Vertex), offsetof(SingleRenderMesh::Vertex, diffuse_u));
+    using PackedVertex = SingleRenderMesh::PackedVertex;
 
-    backend->draw(model.vertices.size());
+    backend->enableVertexAttribute(MeshShader::Attribute::positionLoc, 4, sizeof(PackedVertex), offsetof(PackedVertex, x), AttributeFormat::Unorm16);
+    backend->enableVertexAttribute(MeshShader::Attribute::normalLoc, 2, sizeof(PackedVertex), offsetof(PackedVertex, normal), AttributeFormat::Snorm16);
+    backend->enableVertexAttribute(MeshShader::Attribute::tangentLoc, 2, sizeof(PackedVertex), offsetof(PackedVertex, tangent), AttributeFormat::Snorm16);
+    backend->enableVertexAttribute(MeshShader::Attribute::uvDiffuseLoc, 2, sizeof(PackedVertex), offsetof(PackedVertex, diffuse_u), AttributeFormat::Unorm16);
+
+    // the chunks of a LOD are contiguous
+    auto const first = model.getIndexRange(cmd.lod, cmd.firstChunk);
+    auto const last = model.getIndexRange(cmd.lod, cmd.firstChunk + cmd.chunkCount - 1);
+    backend->drawIndexedInstanced(last.first + last.count - first.first, instanceCount, first.first);
   }
 
   struct MeshShader
@@ -173,8 +495,8 @@ struct MeshRenderPass
       positionLoc = 0,
       uvDiffuseLoc = 1,
       normalLoc = 2,
-      binormalLoc = 3,
       tangentLoc = 4,
+      modelMatrixLoc = 5, // per instance, 4 locations
     };
   };
 
@@ -185,25 +507,56 @@ struct MeshRenderPass
   };
 
   IGraphicsBackend* backend {};
+  const Camera* m_camera {};
   std::unique_ptr<IGpuProgram> m_meshShader;
+  std::vector<Transform> m_transforms;
   std::vector<DrawCommand> m_drawCommands;
+  std::vector<DrawCommand> m_visibleCommands;
+  std::vector<SortEntry> m_sortEntries;
+  std::vector<SortEntry> m_sortScratch;
+
+  // meshes drawn this frame, with the screen size of their closest visible chunk
+  struct TextureUsage
+  {
+    const SingleRenderMesh* mesh;
+    float pixelsPerUnit;
+  };
+
+  std::vector<TextureUsage> m_textureUsage;
+
+  std::vector<Matrix4f> m_modelMatrices; // one per transform
+  Matrix4f m_viewProjection;
+  std::vector<Matrix4f> m_instances;
+  std::unique_ptr<IVertexBuffer> m_instanceBuffer;
   std::vector<Light> m_lights;
+  LightClusters m_lightClusters;
   float m_ambientLight = 0;
   float m_aspectRatio = 1.0;
+  float m_screenHeight = 720; // in pixels
+  float m_lodBias = 1;
 };
 
 struct Renderer : IRenderer, IScreenSizeListener
 {
-  Renderer(IGraphicsBackend* backend_) : backend(backend_), m_skyboxPass(CreateSkyboxPass(backend_, &m_camera)), m_quadsRenderPass(backend_)
+  Renderer(IGraphicsBackend* backend_) : backend(backend_), m_textureStreamer(backend_, &m_loader), m_skyboxPass(CreateSkyboxPass(backend_, &m_camera)), m_quadsRenderPass(backend_)
   {
-    m_textureCache.onCacheMiss = [this] (String path) { return loadTexture(path); };
+    m_textureCache.onCacheMiss = [this] (String path, int64_t& bytes) { return loadTexture(path, bytes); };
+    m_textureCache.budget = int64_t(128) << 20;
+
+    m_meshCache.onCacheMiss = [this] (String path, int64_t& bytes) { return loadModelFile(path, bytes); };
+    m_meshCache.budget = int64_t(64) << 20;
+
+    m_fontTexture = m_textureCache.pin(FontPath);
 
-    loadFontTexture("res/font.png", COLS, ROWS);
+    m_placeholderTexture = backend->createTexture();
+    uploadPlaceholderTexture(m_placeholderTexture.get());
 
     backend->setScreenSizeListener(this);
 
     m_meshRenderPass.m_meshShader = backend->createGpuProgram("mesh", true);
+    m_meshRenderPass.m_instanceBuffer = backend->createVertexBuffer(true);
     m_meshRenderPass.backend = backend;
+    m_meshRenderPass.m_camera = &m_camera;
 
     m_postprocRenderPass.setup(backend, m_screenSize);
   }
@@ -236,25 +589,52 @@ struct Renderer : IRenderer, IScreenSizeListener
     m_enableFsaa = enable;
   }
 
+  void setLodBias(float bias) override
+  {
+    m_meshRenderPass.m_lodBias = bias;
+  }
+
+  void setTextureBudget(int megabytes) override
+  {
+    m_textureStreamer.budget = int64_t(megabytes) << 20;
+  }
+
   void loadModel(int modelId, String path) override
   {
     if((int)m_Models.size() <= modelId)
       m_Models.resize(modelId + 1);
 
-    m_Models[modelId] = loadRenderMesh(path);
+    m_Models[modelId] = m_meshCache.fetch(std::string(path.data, path.len));
+  }
+
+  // The textures of a mesh all come with its diffuse one: its path identifies the set.
+  // Unlike the texture addresses, the paths don't get reused once the textures are evicted.
+  int getTextureSetId(std::string const& diffusePath)
+  {
+    auto i = m_textureSetIds.find(diffusePath);
 
-    int i = 0;
+    if(i == m_textureSetIds.end())
+      i = m_textureSetIds.insert({ diffusePath, (int)m_textureSetIds.size() }).first;
 
-    for(auto& single : m_Models[modelId].singleMeshes)
-    {
-      single.diffuse = m_textureCache.fetch(setExtension(std::string(path.data), std::to_string(i) + ".diffuse.png"));
-      single.normal = m_textureCache.fetch(setExtension(std::string(path.data), std::to_string(i) + ".normal.png"));
-      single.emissive = m_textureCache.fetch(setExtension(std::string(path.data), std::to_string(i) + ".emissive.png"));
+    return i->second;
+  }
 
-      ++i;
-    }
+  void setModelPvs(int modelId, std::shared_ptr<const Pvs> pvs) override
+  {
+    if((int)m_modelPvs.size() <= modelId)
+      m_modelPvs.resize(modelId + 1);
+
+    m_modelPvs[modelId] = std::move(pvs);
+  }
+
+  void unloadModel(int modelId) override
+  {
+    if(modelId < (int)m_Models.size())
+      m_Models[modelId] = nullptr;
 
-    uploadVerticesToGPU(m_Models[modelId]);
+    // the meshes hold their textures
+    m_meshCache.trim();
+    m_textureCache.trim();
   }
 
   void setCamera(Vec3f pos, Quaternion dir) override
@@ -282,8 +662,13 @@ struct Renderer : IRenderer, IScreenSizeListener
   void beginDraw() override
   {
     m_quadsRenderPass.m_quadsToDraw.clear();
+    m_quadsRenderPass.m_textsToDraw.clear();
     m_meshRenderPass.m_drawCommands.clear();
+    m_meshRenderPass.m_transforms.clear();
     m_meshRenderPass.m_lights.clear();
+
+    // no draw command points to the meshes now: they can be replaced
+    ggLoadsPending = m_loader.poll(UploadBudgetUs);
   }
 
   void endDraw() override
@@ -311,7 +696,10 @@ struct Renderer : IRenderer, IScreenSizeListener
     m_skyboxPass->execute(meshRenderTarget);
 
     m_meshRenderPass.m_aspectRatio = aspectRatio;
+    m_meshRenderPass.m_screenHeight = m_screenSize.y;
     m_meshRenderPass.execute(meshRenderTarget);
+    streamTextures();
+    reportCacheStats();
 
     if(m_enablePostProcessing)
       m_postprocRenderPass.execute(screen);
@@ -324,15 +712,53 @@ struct Renderer : IRenderer, IScreenSizeListener
   {
     auto& model = m_Models.at(modelId);
 
-    for(auto& single : model.singleMeshes)
-      m_meshRenderPass.m_drawCommands.push_back({ &single, where, orientation, m_camera, blinking });
+    if(!model)
+      return;
+
+    const int transform = m_meshRenderPass.m_transforms.size();
+    m_meshRenderPass.m_transforms.push_back({ where, orientation });
+
+    auto pvs = modelId < (int)m_modelPvs.size() ? m_modelPvs[modelId].get() : nullptr;
+
+    for(auto& single : model->singleMeshes)
+      m_meshRenderPass.m_drawCommands.push_back({ &single, transform, blinking, 0, (int)single.chunks.size(), 0, pvs, 0 });
   }
 
   void drawText(Vec2f pos, String text) override
+  {
+    layoutText(pos, text, m_quadsRenderPass.m_quadsToDraw);
+  }
+
+  void setText(int textId, String text) override
+  {
+    auto& texts = m_quadsRenderPass.m_texts;
+
+    if((int)texts.size() <= textId)
+      texts.resize(textId + 1);
+
+    auto& retained = texts[textId];
+
+    if(retained.content.compare(0, retained.content.size(), text.data, text.len) == 0)
+      return;
+
+    m_textQuads.clear();
+    layoutText(Vec2f(0, 0), text, m_textQuads);
+    m_quadsRenderPass.retain(retained, m_textQuads);
+    retained.content.assign(text.data, text.len);
+  }
+
+  void drawText(Vec2f pos, int textId) override
+  {
+    if(m_quadsRenderPass.m_texts.at(textId).vertexCount > 0)
+      m_quadsRenderPass.m_textsToDraw.push_back({ textId, pos });
+  }
+
+  // One quad per character, centered on 'pos'
+  void layoutText(Vec2f pos, String text, std::vector<QuadToDraw>& quads)
   {
     Rect2f rect;
-    rect.size.x = 0.25;
-    rect.size.y = 0.25;
+    rect.size.x = TextCharWidth;
+    rect.size.y = TextCharWidth;
     rect.pos.x = pos.x - text.len * rect.size.x / 2;
     rect.pos.y = pos.y;
 
@@ -347,7 +773,7 @@ struct Renderer : IRenderer, IScreenSizeListener
       const float v0 = 1.0f - (row + 1) / ROWS;
       const float v1 = 1.0f - (row + 0) / ROWS;
 
-      m_quadsRenderPass.m_quadsToDraw.push_back({ m_fontTexture.get(), rect, { { u0, v0 }, { u1, v1 } } });
+      quads.push_back({ m_fontTexture.get(), rect, { { u0, v0 }, { u1, v1 } } });
 
       rect.pos.x += rect.size.x;
     }
@@ -368,7 +794,9 @@ private:
   Camera m_camera;
   bool m_cameraValid = false;
   IGraphicsBackend* const backend;
-  std::vector<RenderMesh> m_Models;
+  TextureStreamer m_textureStreamer; // must outlive the textures of the models
+  std::vector<std::shared_ptr<RenderMesh>> m_Models;
+  std::vector<std::shared_ptr<const Pvs>> m_modelPvs; // see 'setModelPvs'
 
   bool m_enableFsaa = false;
   bool m_enablePostProcessing = true;
@@ -376,16 +804,117 @@ private:
   std::unique_ptr<RenderPass> m_skyboxPass;
   MeshRenderPass m_meshRenderPass;
   QuadsRenderPass m_quadsRenderPass;
+  std::vector<QuadToDraw> m_textQuads; // scratch, for 'setText'
   PostProcessRenderPass m_postprocRenderPass;
 
-  WeakCache<std::string, ITexture> m_textureCache;
+  ResourceCache<std::string, ITexture> m_textureCache;
+  ResourceCache<std::string, RenderMesh> m_meshCache;
+  int m_nextMeshId = 0;
+  std::map<std::string, int> m_textureSetIds; // see 'getTextureSetId'
+
   std::shared_ptr<ITexture> m_fontTexture;
+  std::shared_ptr<ITexture> m_placeholderTexture;
+
+  // Last, so it goes first: its workers use the texture streamer
+  JobQueue m_loader { LoaderThreads };
+
+  // Returns a box, replaced by the actual mesh once it's loaded in the background
+  std::shared_ptr<RenderMesh> loadModelFile(String path, int64_t& bytes)
+  {
+    auto r = std::make_shared<RenderMesh>(boxModel());
+
+    for(auto& single : r->singleMeshes)
+    {
+      single.diffuse = m_placeholderTexture;
+      single.normal = m_placeholderTexture;
+      single.emissive = m_placeholderTexture;
+      single.textureSetId = getTextureSetId("");
+    }
+
+    setupModel(*r);
+    bytes = getMeshBytes(*r);
+
+    const std::string key(path.data, path.len);
+    auto loaded = std::make_shared<RenderMesh>();
+    std::weak_ptr<RenderMesh> target = r;
+    auto decodeUs = std::make_shared<int64_t>(0);
+
+    auto work = [key, loaded, decodeUs] ()
+      {
+        auto const t0 = GetSteadyClockUs();
+
+        try
+        {
+          *loaded = loadRenderMesh(key);
+          *decodeUs = GetSteadyClockUs() - t0;
+        }
+        catch(std::exception const& e)
+        {
+          printf("[display] can't load mesh '%s' (%s)\n", key.c_str(), e.what());
+        }
+        catch(Error const& e)
+        {
+          const auto msg = e.message();
+          printf("[display] can't load mesh '%s' (%.*s)\n", key.c_str(), msg.len, msg.data);
+        }
+      };
+
+    auto done = [this, key, loaded, target, decodeUs] ()
+      {
+        auto const t0 = GetSteadyClockUs();
+        auto mesh = target.lock();
+
+        // evicted in the meantime, or failed: keep the box
+        if(!mesh || loaded->singleMeshes.empty())
+          return;
 
-  void loadFontTexture(String path, int COLS, int ROWS)
+        for(auto& single : loaded->singleMeshes)
+        {
+          // shared by the materials of the same texture array
+          const auto array = std::to_string(single.textureArray);
+          const auto diffusePath = setExtension(key, array + ".diffuse.tex");
+          single.diffuse = m_textureCache.fetch(diffusePath);
+          single.normal = m_textureCache.fetch(setExtension(key, array + ".normal.tex"));
+          single.emissive = m_textureCache.fetch(setExtension(key, array + ".emissive.tex"));
+          single.textureSetId = getTextureSetId(diffusePath);
+        }
+
+        setupModel(*loaded);
+        *mesh = std::move(*loaded);
+        m_meshCache.setBytes(key, getMeshBytes(*mesh));
+
+        // the app can't time it: loadModel returns before the mesh is there
+        auto const uploadUs = GetSteadyClockUs() - t0;
+        printf("[renderer] loaded '%s': %.1f ms (read and decode: %.1f ms, in the background, upload: %.1f ms)\n",
+               key.c_str(), (*decodeUs + uploadUs) / 1000.0, *decodeUs / 1000.0, uploadUs / 1000.0);
+      };
+
+    m_loader.push(work, done);
+
+    return r;
+  }
+
+  void setupModel(RenderMesh& mesh)
+  {
+    for(auto& single : mesh.singleMeshes)
+    {
+      single.meshId = m_nextMeshId++;
+    }
+
+    uploadVerticesToGPU(mesh);
+  }
+
+  static int64_t getMeshBytes(RenderMesh const& mesh)
   {
-    m_fontTexture = backend->createTexture();
-    m_fontTexture->upload(addBorderToTiles(loadPicture(path), COLS, ROWS));
-    m_fontTexture->setNoRepeat();
+    int64_t r = 0;
+
+    for(auto& single : mesh.singleMeshes)
+    {
+      r += single.packedVertices.size() * sizeof(single.packedVertices[0]);
+      r += single.indices.size() * sizeof(single.indices[0]);
+    }
+
+    return r;
   }
 
   void uploadVerticesToGPU(RenderMesh& mesh)
@@ -393,17 +922,92 @@ private:
     for(auto& model : mesh.singleMeshes)
     {
       model.vb = backend->createVertexBuffer();
-      model.vb->upload((uint8_t*)model.vertices.data(), sizeof(model.vertices[0]) * model.vertices.size());
+      model.vb->upload((uint8_t*)model.packedVertices.data(), sizeof(model.packedVertices[0]) * model.packedVertices.size());
+
+      model.ib = backend->createIndexBuffer();
+
+      if(model.packedVertices.size() <= 0x10000)
+      {
+        std::vector<uint16_t> indices(model.indices.begin(), model.indices.end());
+        model.ib->upload(indices.data(), indices.size(), sizeof indices[0]);
+      }
+      else
+      {
+        model.ib->upload(model.indices.data(), model.indices.size(), sizeof model.indices[0]);
+      }
     }
   }
 
-  std::unique_ptr<ITexture> loadTexture(String path)
+  std::unique_ptr<ITexture> loadTexture(String path, int64_t& bytes)
   {
+    if(endsWith(std::string(path.data, path.len), ".tex"))
+      return loadCookedTexture(path, bytes);
+
     auto pic = loadPicture(path);
     auto texture = backend->createTexture();
+
+    const bool isFont = std::string(path.data, path.len) == FontPath;
+
+    if(isFont)
+      pic = addBorderToTiles(pic, COLS, ROWS);
+
     texture->upload(pic);
+
+    // after the upload, which resets the sampling parameters
+    if(isFont)
+      texture->setNoRepeat();
+
+    bytes = int64_t(pic.dim.x) * pic.dim.y * 4;
     return texture;
   }
+
+  // no decoding: the file holds the texels and their mip levels, as GL expects them.
+  // The streamer loads it in the background, then takes care of the finer levels.
+  // Its size is the size of all the levels: the memory actually used is up to the streamer.
+  std::unique_ptr<ITexture> loadCookedTexture(String path, int64_t& bytes)
+  {
+    const std::string key(path.data, path.len);
+
+    bytes = 0; // known once loaded
+    return m_textureStreamer.createTexture(path, [this, key] (int64_t size) { m_textureCache.setBytes(key, size); });
+  }
+
+  // Texture detail needed by the meshes drawn this frame
+  void streamTextures()
+  {
+    for(auto& usage : m_meshRenderPass.m_textureUsage)
+    {
+      auto& q = usage.mesh->quantization;
+
+      // texture coordinates per model space unit, assuming an even mapping
+      const float uvSize = std::max(q.uvScale.x, q.uvScale.y);
+      const float positionSize = std::max(q.positionScale.x, std::max(q.positionScale.y, q.positionScale.z));
+
+      if(positionSize <= 0)
+        continue;
+
+      const float uvPerPixel = uvSize / positionSize / usage.pixelsPerUnit;
+
+      m_textureStreamer.request(usage.mesh->diffuse.get(), uvPerPixel);
+      m_textureStreamer.request(usage.mesh->normal.get(), uvPerPixel);
+      m_textureStreamer.request(usage.mesh->emissive.get(), uvPerPixel);
+    }
+
+    m_textureStreamer.update();
+  }
+
+  void reportCacheStats()
+  {
+    ggTextureCacheMegabytes = m_textureCache.getBytes() / (1024.0 * 1024.0);
+    ggTextureCacheHits = m_textureCache.stats.hits;
+    ggTextureCacheMisses = m_textureCache.stats.misses;
+    ggTextureCacheEvictions = m_textureCache.stats.evictions;
+
+    ggMeshCacheMegabytes = m_meshCache.getBytes() / (1024.0 * 1024.0);
+    ggMeshCacheHits = m_meshCache.stats.hits;
+    ggMeshCacheMisses = m_meshCache.stats.misses;
+    ggMeshCacheEvictions = m_meshCache.stats.evictions;
+  }
 };
 }
 
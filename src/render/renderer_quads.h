@@ -1,6 +1,13 @@
 #pragma once
 
 #include "renderpass.h"
+#include "streaming_buffer.h"
+
+#include <algorithm> // sort, min, max
+#include <cmath> // lround
+#include <cstdint>
+#include <string>
+#include <vector>
 
 struct QuadToDraw
 {
@@ -9,11 +16,26 @@ struct QuadToDraw
   Vec2f uv[2];
 };
 
+// Quads kept on the GPU from one frame to the next, e.g the glyphs of a HUD message
+struct RetainedText
+{
+  std::string content;
+  std::unique_ptr<IVertexBuffer> vb;
+  ITexture* tex = nullptr;
+  int vertexCount = 0;
+};
+
+struct TextToDraw
+{
+  int textId;
+  Vec2f pos;
+};
+
 struct QuadsRenderPass : RenderPass
 {
   QuadsRenderPass(IGraphicsBackend * backend_) : backend(backend_)
     , m_textShader(backend->createGpuProgram("text", false))
-    , m_vb(backend->createVertexBuffer(true))
+    , m_vb(backend_, 256 * 1024)
   {
   }
 
@@ -29,62 +51,60 @@ struct QuadsRenderPass : RenderPass
         return false;
       };
 
-    backend->useGpuProgram(m_textShader.get());
-
     std::sort(m_quadsToDraw.begin(), m_quadsToDraw.end(), byLexico);
 
-    ITexture* currTexture = nullptr;
-
-    std::vector<SingleRenderMesh::Vertex> pendingVertices;
+    // all the quads of the frame go to the GPU at once, the batches use parts of them
+    m_vertices.clear();
+    m_batches.clear();
 
-    auto flushQuads = [&]()
-      {
-        if(pendingVertices.empty())
-          return;
+    for(auto& cmd : m_quadsToDraw)
+    {
+      if(m_batches.empty() || m_batches.back().tex != cmd.tex)
+        m_batches.push_back({ cmd.tex, (int)m_vertices.size(), 0 });
 
-        m_vb->upload(pendingVertices.data(), pendingVertices.size() * sizeof(pendingVertices[0]));
-        backend->useVertexBuffer(m_vb.get());
+      tessellate(cmd, m_aspectRatio, m_vertices);
+      m_batches.back().vertexCount += 6;
+    }
 
-        backend->enableVertexAttribute(TextShader::Attribute::positionLoc, 2, sizeof(SingleRenderMesh::Vertex), OFFSET(SingleRenderMesh::Vertex, x));
-        backend->enableVertexAttribute(TextShader::Attribute::uvDiffuseLoc, 2, sizeof(SingleRenderMesh::Vertex), OFFSET(SingleRenderMesh::Vertex, diffuse_u));
+    m_vb.beginFrame();
 
-        backend->draw(pendingVertices.size());
+    if(m_vertices.empty() && m_textsToDraw.empty())
+      return;
 
-        pendingVertices.clear();
-      };
+    backend->useGpuProgram(m_textShader.get());
 
-    for(auto& cmd : m_quadsToDraw)
+    if(!m_vertices.empty())
     {
-      if(cmd.tex != currTexture)
+      const int offset = m_vb.push(m_vertices.data(), m_vertices.size() * sizeof(QuadVertex), sizeof(QuadVertex));
+      const int firstVertex = offset / sizeof(QuadVertex);
+
+      Placement placement { 0, 0, 1, 1 };
+      backend->setUniformBlock(&placement, sizeof placement);
+
+      useVertexBuffer(m_vb.get());
+
+      for(auto& batch : m_batches)
       {
-        flushQuads();
-        cmd.tex->bind(1);
-        currTexture = cmd.tex;
+        batch.tex->bind(1);
+        backend->draw(batch.vertexCount, firstVertex + batch.firstVertex);
       }
+    }
 
-      const Vec2f size = cmd.where.size * 0.1;
-      const Vec2f pos = cmd.where.pos * 0.1;
-
-      const auto x0 = pos.x;
-      const auto x1 = pos.x + size.x;
-      const auto y0 = pos.y;
-      const auto y1 = pos.y + size.y * m_aspectRatio;
+    // one draw per retained text, its placement goes to the shader
+    for(auto& cmd : m_textsToDraw)
+    {
+      auto& text = m_texts[cmd.textId];
 
-      const auto u0 = cmd.uv[0].x;
-      const auto u1 = cmd.uv[1].x;
-      const auto v0 = cmd.uv[0].y;
-      const auto v1 = cmd.uv[1].y;
+      if(text.vertexCount == 0)
+        continue;
 
-      pendingVertices.push_back({ x0, y0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, /*UV*/ u0, v0 });
-      pendingVertices.push_back({ x1, y0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, /*UV*/ u1, v0 });
-      pendingVertices.push_back({ x1, y1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, /*UV*/ u1, v1 });
+      Placement placement { cmd.pos.x * 0.1f, cmd.pos.y * 0.1f, 1, m_aspectRatio };
+      backend->setUniformBlock(&placement, sizeof placement);
 
-      pendingVertices.push_back({ x0, y0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, /*UV*/ u0, v0 });
-      pendingVertices.push_back({ x1, y1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, /*UV*/ u1, v1 });
-      pendingVertices.push_back({ x0, y1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, /*UV*/ u0, v1 });
+      useVertexBuffer(text.vb.get());
+      text.tex->bind(1);
+      backend->draw(text.vertexCount, 0);
     }
-
-    flushQuads();
   }
 
   struct TextShader
@@ -96,10 +116,92 @@ struct QuadsRenderPass : RenderPass
     };
   };
 
+  // 12 bytes. The texture coordinates must be in [0;1].
+  struct QuadVertex
+  {
+    float x, y;
+    uint16_t u, v;
+  };
+
+  struct Batch
+  {
+    ITexture* tex;
+    int firstVertex;
+    int vertexCount;
+  };
+
+  // Must match the uniform block of the text shader
+  struct Placement
+  {
+    float x, y; // offset
+    float scaleX, scaleY;
+  };
+
+  // Tessellates 'quads', which all use the same texture, into 'text'.
+  // The quads are placed when drawn, so they're laid out around (0;0).
+  void retain(RetainedText& text, std::vector<QuadToDraw> const& quads)
+  {
+    m_vertices.clear();
+
+    for(auto& quad : quads)
+      tessellate(quad, 1, m_vertices);
+
+    if(!text.vb)
+      text.vb = backend->createVertexBuffer();
+
+    if(!m_vertices.empty())
+      text.vb->upload(m_vertices.data(), m_vertices.size() * sizeof(QuadVertex));
+
+    text.tex = quads.empty() ? nullptr : quads[0].tex;
+    text.vertexCount = m_vertices.size();
+  }
+
+  void useVertexBuffer(IVertexBuffer* vb)
+  {
+    backend->useVertexBuffer(vb);
+    backend->enableVertexAttribute(TextShader::Attribute::positionLoc, 2, sizeof(QuadVertex), OFFSET(QuadVertex, x));
+    backend->enableVertexAttribute(TextShader::Attribute::uvDiffuseLoc, 2, sizeof(QuadVertex), OFFSET(QuadVertex, u), AttributeFormat::Unorm16);
+  }
+
+  // Appends the two triangles of 'cmd'
+  static void tessellate(QuadToDraw const& cmd, float aspectRatio, std::vector<QuadVertex>& vertices)
+  {
+    const Vec2f size = cmd.where.size * 0.1;
+    const Vec2f pos = cmd.where.pos * 0.1;
+
+    const auto x0 = pos.x;
+    const auto x1 = pos.x + size.x;
+    const auto y0 = pos.y;
+    const auto y1 = pos.y + size.y * aspectRatio;
+
+    const auto u0 = toUnorm16(cmd.uv[0].x);
+    const auto u1 = toUnorm16(cmd.uv[1].x);
+    const auto v0 = toUnorm16(cmd.uv[0].y);
+    const auto v1 = toUnorm16(cmd.uv[1].y);
+
+    vertices.push_back({ x0, y0, u0, v0 });
+    vertices.push_back({ x1, y0, u1, v0 });
+    vertices.push_back({ x1, y1, u1, v1 });
+
+    vertices.push_back({ x0, y0, u0, v0 });
+    vertices.push_back({ x1, y1, u1, v1 });
+    vertices.push_back({ x0, y1, u0, v1 });
+  }
+
+  static uint16_t toUnorm16(float val)
+  {
+    return (uint16_t)std::lround(std::min(std::max(val, 0.0f), 1.0f) * 65535.0f);
+  }
+
   IGraphicsBackend* const backend;
   std::unique_ptr<IGpuProgram> m_textShader;
-  std::unique_ptr<IVertexBuffer> m_vb;
+  StreamingVertexBuffer m_vb;
   std::vector<QuadToDraw> m_quadsToDraw;
+  std::vector<TextToDraw> m_textsToDraw;
+  std::vector<RetainedText> m_texts; // indexed by text id
   float m_aspectRatio = 1.0;
-};
 
+  // kept from one frame to the next, so a frame full of text doesn't allocate
+  std::vector<QuadVertex> m_vertices;
+  std::vector<Batch> m_batches;
+};
@@ -8,11 +8,17 @@
 #include "engine/rendermesh.h"
 #include "misc/decompress.h"
 #include "misc/file.h"
+#include "misc/mesh_simplify.h"
+#include "misc/vertex_cache.h"
+#include <algorithm> // min, max
 #include <cassert>
+#include <cmath> // floor, fabs, lround
+#include <map>
 #include <stdexcept>
 #include <string.h> // memcpy
+#include <tuple>
+#include <unordered_map>
 
-static
 RenderMesh boxModel()
 {
   static const SingleRenderMesh::Vertex vertices[] =
@@ -70,6 +76,10 @@ RenderMesh boxModel()
   for(auto idx : faces)
     model.singleMeshes[0].vertices.push_back(vertices[idx]);
 
+  splitIntoChunks(model.singleMeshes[0], 1000);
+  weldVertices(model.singleMeshes[0]);
+  packVertices(model);
+
   return model;
 }
 
@@ -96,6 +106,13 @@ RenderMesh loadBinaryRenderMesh(String path)
     SingleRenderMesh single;
 
     read(&single.transparency, 1);
+    read(&single.textureArray, 4);
+    read(&single.textureLayer, 4);
+
+    if(single.textureArray < 0 || single.textureLayer < 0)
+      throw std::runtime_error("Invalid texture layer in '" + std::string(path.data) + "'");
+
+    read(&single.quantization, sizeof single.quantization);
 
     int vertexCount = 0;
     read(&vertexCount, 4);
@@ -103,12 +120,77 @@ RenderMesh loadBinaryRenderMesh(String path)
     if(vertexCount <= 0)
       throw std::runtime_error("Mesh with no vertices in '" + std::string(path.data) + "'");
 
-    for(int i = 0; i < vertexCount; ++i)
+    single.packedVertices.resize(vertexCount);
+    read(single.packedVertices.data(), vertexCount * sizeof(SingleRenderMesh::PackedVertex));
+
+    int indexSize = 0;
+    read(&indexSize, 4);
+
+    int indexCount = 0;
+    read(&indexCount, 4);
+
+    if(indexSize != 2 && indexSize != 4)
+      throw std::runtime_error("Invalid index size in '" + std::string(path.data) + "'");
+
+    if(indexCount <= 0 || indexCount % 3)
+      throw std::runtime_error("Invalid index count in '" + std::string(path.data) + "'");
+
+    single.indices.resize(indexCount);
+
+    for(auto& index : single.indices)
+    {
+      if(indexSize == 2)
+      {
+        uint16_t index16;
+        read(&index16, 2);
+        index = index16;
+      }
+      else
+      {
+        read(&index, 4);
+      }
+
+      if(index >= (uint32_t)vertexCount)
+        throw std::runtime_error("Invalid index in '" + std::string(path.data) + "'");
+    }
+
+    int chunkCount = 0;
+    read(&chunkCount, 4);
+
+    for(int i = 0; i < chunkCount; ++i)
     {
-      SingleRenderMesh::Vertex vertex;
-      read(&vertex, sizeof vertex);
+      SingleRenderMesh::Chunk chunk;
+      read(&chunk, sizeof chunk);
 
-      single.vertices.push_back(vertex);
+      if(chunk.firstIndex < 0 || chunk.indexCount <= 0 || chunk.firstIndex + chunk.indexCount > indexCount)
+        throw std::runtime_error("Invalid mesh chunk in '" + std::string(path.data) + "'");
+
+      single.chunks.push_back(chunk);
+    }
+
+    if(single.chunks.empty())
+      throw std::runtime_error("Mesh with no chunks in '" + std::string(path.data) + "'");
+
+    int lodCount = 0;
+    read(&lodCount, 4);
+
+    if(lodCount < 0 || lodCount >= MaxLods)
+      throw std::runtime_error("Invalid LOD count in '" + std::string(path.data) + "'");
+
+    single.lods.resize(lodCount);
+
+    for(auto& lod : single.lods)
+    {
+      read(&lod.error, 4);
+      lod.chunks.resize(chunkCount);
+
+      for(auto& range : lod.chunks)
+      {
+        read(&range, sizeof range);
+
+        if(range.first < 0 || range.count < 0 || range.first + range.count > indexCount)
+          throw std::runtime_error("Invalid LOD chunk in '" + std::string(path.data) + "'");
+      }
     }
 
     mesh.singleMeshes.push_back(single);
@@ -125,3 +207,396 @@ RenderMesh loadRenderMesh(String renderPath)
   return loadBinaryRenderMesh(renderPath);
 }
 
+void splitIntoChunks(SingleRenderMesh& mesh, float chunkSize)
+{
+  using Vertex = SingleRenderMesh::Vertex;
+  using Cell = std::tuple<int, int, int>;
+
+  assert(mesh.indices.empty());
+
+  // the grid starts at the mesh corner, so meshes smaller than a cell get one chunk
+  Vec3f origin = mesh.vertices.empty() ? Vec3f() : Vec3f(mesh.vertices[0].x, mesh.vertices[0].y, mesh.vertices[0].z);
+
+  for(auto& v : mesh.vertices)
+  {
+    origin.x = std::min(origin.x, v.x);
+    origin.y = std::min(origin.y, v.y);
+    origin.z = std::min(origin.z, v.z);
+  }
+
+  std::map<Cell, std::vector<Vertex>> trianglesByCell;
+
+  for(int i = 0; i + 2 < (int)mesh.vertices.size(); i += 3)
+  {
+    auto tri = &mesh.vertices[i];
+
+    const float cx = (tri[0].x + tri[1].x + tri[2].x) / 3 - origin.x;
+    const float cy = (tri[0].y + tri[1].y + tri[2].y) / 3 - origin.y;
+    const float cz = (tri[0].z + tri[1].z + tri[2].z) / 3 - origin.z;
+
+    const Cell cell { (int)floor(cx / chunkSize), (int)floor(cy / chunkSize), (int)floor(cz / chunkSize) };
+
+    auto& dst = trianglesByCell[cell];
+    dst.insert(dst.end(), tri, tri + 3);
+  }
+
+  mesh.vertices.clear();
+  mesh.chunks.clear();
+
+  for(auto& pair : trianglesByCell)
+  {
+    auto& vertices = pair.second;
+
+    SingleRenderMesh::Chunk chunk;
+    chunk.firstIndex = mesh.vertices.size(); // soup: one index per vertex
+    chunk.indexCount = vertices.size();
+    chunk.boundsMin = chunk.boundsMax = Vec3f(vertices[0].x, vertices[0].y, vertices[0].z);
+
+    for(auto& v : vertices)
+    {
+      chunk.boundsMin.x = std::min(chunk.boundsMin.x, v.x);
+      chunk.boundsMin.y = std::min(chunk.boundsMin.y, v.y);
+      chunk.boundsMin.z = std::min(chunk.boundsMin.z, v.z);
+      chunk.boundsMax.x = std::max(chunk.boundsMax.x, v.x);
+      chunk.boundsMax.y = std::max(chunk.boundsMax.y, v.y);
+      chunk.boundsMax.z = std::max(chunk.boundsMax.z, v.z);
+    }
+
+    mesh.chunks.push_back(chunk);
+    mesh.vertices.insert(mesh.vertices.end(), vertices.begin(), vertices.end());
+  }
+}
+
+
+void weldVertices(SingleRenderMesh& mesh)
+{
+  using Vertex = SingleRenderMesh::Vertex;
+
+  assert(mesh.indices.empty());
+
+  struct Hash
+  {
+    size_t operator () (Vertex const& v) const
+    {
+      // FNV-1a
+      auto bytes = (const uint8_t*)&v;
+      uint32_t h = 2166136261u;
+
+      for(size_t i = 0; i < sizeof v; ++i)
+        h = (h ^ bytes[i]) * 16777619u;
+
+      return h;
+    }
+  };
+
+  struct Equal
+  {
+    bool operator () (Vertex const& a, Vertex const& b) const
+    {
+      return memcmp(&a, &b, sizeof a) == 0;
+    }
+  };
+
+  std::unordered_map<Vertex, uint32_t, Hash, Equal> indexByVertex;
+  std::vector<Vertex> vertices;
+
+  mesh.indices.reserve(mesh.vertices.size());
+
+  for(auto& v : mesh.vertices)
+  {
+    auto i = indexByVertex.insert({ v, (uint32_t)vertices.size() });
+
+    if(i.second)
+      vertices.push_back(v);
+
+    mesh.indices.push_back(i.first->second);
+  }
+
+  mesh.vertices = std::move(vertices);
+}
+
+namespace
+{
+// Numbers the vertices used by a chunk from 0, so the per-vertex arrays
+// of the optimizers are sized after the chunk, not after the whole mesh.
+struct ChunkVertices
+{
+  ChunkVertices(int meshVertexCount) : m_localIndex(meshVertexCount, -1) {}
+
+  void build(Span<const uint32_t> meshIndices)
+  {
+    for(auto i : meshVertices)
+      m_localIndex[i] = -1;
+
+    meshVertices.clear();
+    indices.clear();
+
+    for(auto i : meshIndices)
+    {
+      if(m_localIndex[i] < 0)
+      {
+        m_localIndex[i] = meshVertices.size();
+        meshVertices.push_back(i);
+      }
+
+      indices.push_back(m_localIndex[i]);
+    }
+  }
+
+  std::vector<uint32_t> indices; // local
+  std::vector<uint32_t> meshVertices; // index in the mesh of each local vertex
+
+private:
+  std::vector<int> m_localIndex; // per vertex of the mesh, -1 if not in the chunk
+};
+}
+
+void generateLods(SingleRenderMesh& mesh)
+{
+  assert(mesh.packedVertices.empty());
+
+  // a LOD must remove at least this much of the previous one to be worth it
+  static const float MinReduction = 0.2f;
+
+  std::vector<Vec3f> positions;
+
+  for(auto& v : mesh.vertices)
+    positions.push_back(Vec3f(v.x, v.y, v.z));
+
+  mesh.lods.clear();
+
+  ChunkVertices local(mesh.vertices.size());
+  std::vector<Vec3f> localPositions;
+  float error = 0;
+
+  while(1 + (int)mesh.lods.size() < MaxLods)
+  {
+    const int prev = mesh.lods.size();
+
+    SingleRenderMesh::Lod lod;
+    std::vector<uint32_t> lodIndices;
+    int prevIndexCount = 0;
+    float lodError = 0;
+
+    for(int chunk = 0; chunk < (int)mesh.chunks.size(); ++chunk)
+    {
+      auto const range = mesh.getIndexRange(prev, chunk);
+      Span<const uint32_t> indices(mesh.indices.data() + range.first, range.count);
+
+      local.build(indices);
+      localPositions.clear();
+
+      for(auto i : local.meshVertices)
+        localPositions.push_back(positions[i]);
+
+      float chunkError;
+      auto const simplified = simplifyMesh(local.indices, localPositions, range.count / 3 / 2, chunkError);
+
+      lod.chunks.push_back({ int(mesh.indices.size() + lodIndices.size()), (int)simplified.size() });
+
+      for(auto i : simplified)
+        lodIndices.push_back(local.meshVertices[i]);
+
+      prevIndexCount += range.count;
+      lodError = std::max(lodError, chunkError);
+    }
+
+    if(lodIndices.size() > prevIndexCount * (1 - MinReduction))
+      break;
+
+    // each LOD is simplified from the previous one: the errors add up
+    error += lodError;
+    lod.error = error;
+
+    mesh.indices.insert(mesh.indices.end(), lodIndices.begin(), lodIndices.end());
+    mesh.lods.push_back(std::move(lod));
+  }
+}
+
+void optimizeTriangleOrder(SingleRenderMesh& mesh)
+{
+  assert(mesh.packedVertices.empty());
+
+  std::vector<Vec3f> positions;
+
+  for(auto& v : mesh.vertices)
+    positions.push_back(Vec3f(v.x, v.y, v.z));
+
+  ChunkVertices local(mesh.vertices.size());
+
+  // the triangles can't leave their chunk
+  for(int lod = 0; lod <= (int)mesh.lods.size(); ++lod)
+  {
+    for(int chunk = 0; chunk < (int)mesh.chunks.size(); ++chunk)
+    {
+      auto const range = mesh.getIndexRange(lod, chunk);
+      Span<uint32_t> indices(mesh.indices.data() + range.first, range.count);
+
+      local.build(indices);
+      auto const clusters = optimizeVertexCache(local.indices, local.meshVertices.size());
+
+      for(int i = 0; i < range.count; ++i)
+        indices[i] = local.meshVertices[local.indices[i]];
+
+      optimizeOverdraw(indices, clusters, positions);
+    }
+  }
+
+  auto const oldIndex = optimizeVertexFetch(mesh.indices, mesh.vertices.size());
+
+  std::vector<SingleRenderMesh::Vertex> vertices;
+  vertices.reserve(oldIndex.size());
+
+  for(auto i : oldIndex)
+    vertices.push_back(mesh.vertices[i]);
+
+  mesh.vertices = std::move(vertices);
+}
+
+static
+uint16_t quantize(float val, float offset, float scale)
+{
+  const float f = scale ? (val - offset) / scale : 0;
+  return (uint16_t)std::lround(std::min(std::max(f, 0.0f), 1.0f) * 0xFFFF);
+}
+
+static
+float dequantize(uint16_t val, float offset, float scale)
+{
+  return offset + scale * (val / float(0xFFFF));
+}
+
+static
+int16_t toSnorm16(float val)
+{
+  return (int16_t)std::lround(std::min(std::max(val, -1.0f), 1.0f) * 0x7FFF);
+}
+
+static
+float fromSnorm16(int16_t val)
+{
+  return std::max(val / float(0x7FFF), -1.0f);
+}
+
+// Projects the unit sphere on an octahedron, then unfolds it on a square.
+static
+void encodeOctahedral(Vec3f n, int16_t (& dst)[2])
+{
+  const auto sum = fabs(n.x) + fabs(n.y) + fabs(n.z);
+
+  if(sum == 0)
+  {
+    dst[0] = dst[1] = 0; // +Z
+    return;
+  }
+
+  n = n * (1.0f / sum);
+
+  if(n.z < 0)
+  {
+    const auto x = (1 - fabs(n.y)) * (n.x >= 0 ? 1 : -1);
+    const auto y = (1 - fabs(n.x)) * (n.y >= 0 ? 1 : -1);
+    n.x = x;
+    n.y = y;
+  }
+
+  dst[0] = toSnorm16(n.x);
+  dst[1] = toSnorm16(n.y);
+}
+
+// Must match 'octDecode' in mesh.vert
+static
+Vec3f decodeOctahedral(const int16_t (& src)[2])
+{
+  Vec3f n(fromSnorm16(src[0]), fromSnorm16(src[1]), 0);
+  n.z = 1 - fabs(n.x) - fabs(n.y);
+
+  const auto t = std::max(-n.z, 0.0f);
+  n.x += n.x >= 0 ? -t : t;
+  n.y += n.y >= 0 ? -t : t;
+
+  return normalize(n);
+}
+
+void packVertices(RenderMesh& mesh)
+{
+  using Vertex = SingleRenderMesh::Vertex;
+
+  Vec3f posMin, posMax;
+  Vec2f uvMin, uvMax;
+  bool first = true;
+
+  for(auto& single : mesh.singleMeshes)
+  {
+    for(auto& v : single.vertices)
+    {
+      if(first)
+      {
+        posMin = posMax = Vec3f(v.x, v.y, v.z);
+        uvMin = uvMax = Vec2f(v.diffuse_u, v.diffuse_v);
+        first = false;
+      }
+
+      posMin = Vec3f(std::min(posMin.x, v.x), std::min(posMin.y, v.y), std::min(posMin.z, v.z));
+      posMax = Vec3f(std::max(posMax.x, v.x), std::max(posMax.y, v.y), std::max(posMax.z, v.z));
+      uvMin = Vec2f(std::min(uvMin.x, v.diffuse_u), std::min(uvMin.y, v.diffuse_v));
+      uvMax = Vec2f(std::max(uvMax.x, v.diffuse_u), std::max(uvMax.y, v.diffuse_v));
+    }
+  }
+
+  SingleRenderMesh::Quantization q;
+  q.positionOffset = posMin;
+  q.positionScale = posMax - posMin;
+  q.uvOffset = uvMin;
+  q.uvScale = uvMax - uvMin;
+
+  for(auto& single : mesh.singleMeshes)
+  {
+    single.quantization = q;
+    single.packedVertices.clear();
+
+    for(Vertex const& v : single.vertices)
+    {
+      const Vec3f n(v.nx, v.ny, v.nz);
+      const Vec3f t(v.tx, v.ty, v.tz);
+      const Vec3f b(v.bx, v.by, v.bz);
+
+      SingleRenderMesh::PackedVertex r;
+      r.x = quantize(v.x, q.positionOffset.x, q.positionScale.x);
+      r.y = quantize(v.y, q.positionOffset.y, q.positionScale.y);
+      r.z = quantize(v.z, q.positionOffset.z, q.positionScale.z);
+      r.handedness = dotProduct(crossProduct(n, t), b) >= 0 ? 0xFFFF : 0;
+      encodeOctahedral(n, r.normal);
+      encodeOctahedral(t, r.tangent);
+      r.diffuse_u = quantize(v.diffuse_u, q.uvOffset.x, q.uvScale.x);
+      r.diffuse_v = quantize(v.diffuse_v, q.uvOffset.y, q.uvScale.y);
+      single.packedVertices.push_back(r);
+    }
+
+    single.vertices.clear();
+  }
+}
+
+SingleRenderMesh::Vertex unpackVertex(SingleRenderMesh::PackedVertex const& v, SingleRenderMesh::Quantization const& q)
+{
+  const auto n = decodeOctahedral(v.normal);
+  const auto t = decodeOctahedral(v.tangent);
+  const auto b = crossProduct(n, t) * (v.handedness ? 1.0f : -1.0f);
+
+  SingleRenderMesh::Vertex r;
+  r.x = dequantize(v.x, q.positionOffset.x, q.positionScale.x);
+  r.y = dequantize(v.y, q.positionOffset.y, q.positionScale.y);
+  r.z = dequantize(v.z, q.positionOffset.z, q.positionScale.z);
+  r.nx = n.x;
+  r.ny = n.y;
+  r.nz = n.z;
+  r.bx = b.x;
+  r.by = b.y;
+  r.bz = b.z;
+  r.tx = t.x;
+  r.ty = t.y;
+  r.tz = t.z;
+  r.diffuse_u = dequantize(v.diffuse_u, q.uvOffset.x, q.uvScale.x);
+  r.diffuse_v = dequantize(v.diffuse_v, q.uvOffset.y, q.uvScale.y);
+  return r;
+}
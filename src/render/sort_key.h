@@ -0,0 +1,64 @@
+// Copyright (C) 2026 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+// Packed 64-bit sort keys for the mesh draw commands.
+//
+// Opaque draws are grouped by state, then sorted front to back (less overdraw):
+//   63: translucent (0) | 62-51: texture set | 50-39: mesh | 38: blinking | 37-36: LOD | 35-24: first chunk | 23-16: chunk count | 15-0: depth
+//
+// Translucent draws come last, back to front (correct blending):
+//   63: translucent (1) | 62-39: depth (inverted) | 38-27: texture set | 26-15: mesh | 14: blinking | 13-12: LOD | 11-0: first chunk
+//
+// Ids are truncated: a collision only makes the grouping less efficient.
+
+#pragma once
+
+#include <algorithm> // min, max
+#include <cstdint>
+
+struct SortKeyFields
+{
+  bool translucent;
+  int textureSet;
+  int mesh;
+  bool blinking;
+  int firstChunk;
+  int chunkCount;
+  int lod;
+  float depth; // distance to the camera
+};
+
+constexpr auto SortKeyMaxDepth = 1000.0f;
+
+inline
+uint64_t makeSortKey(SortKeyFields const& f)
+{
+  auto field = [] (uint64_t val, int bits, int shift)
+    {
+      return (val & ((1ull << bits) - 1)) << shift;
+    };
+
+  const auto depth = (uint64_t)(std::min(std::max(f.depth / SortKeyMaxDepth, 0.0f), 1.0f) * 0xFFFFFF);
+
+  if(!f.translucent)
+  {
+    return field(f.textureSet, 12, 51)
+           | field(f.mesh, 12, 39)
+           | field(f.blinking, 1, 38)
+           | field(f.lod, 2, 36)
+           | field(f.firstChunk, 12, 24)
+           | field(f.chunkCount, 8, 16)
+           | field(depth >> 8, 16, 0);
+  }
+
+  return field(1, 1, 63)
+         | field(0xFFFFFF - depth, 24, 39)
+         | field(f.textureSet, 12, 27)
+         | field(f.mesh, 12, 15)
+         | field(f.blinking, 1, 14)
+         | field(f.lod, 2, 12)
+         | field(f.firstChunk, 12, 0);
+}
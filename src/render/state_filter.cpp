@@ -0,0 +1,363 @@
+// Copyright (C) 2026 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+#include "engine/state_filter.h"
+
+#include <cassert>
+
+#include "misc/stats.h"
+#include "picture.h"
+
+namespace
+{
+Gauge ggStateChangesIssued("State changes issued");
+Gauge ggStateChangesSkipped("State changes skipped");
+
+constexpr auto MaxTextureUnits = 16;
+constexpr auto MaxVertexAttributes = 16;
+
+struct StateFilter;
+
+// The wrappers below forget the cached state referring to them when destroyed,
+// so a new object allocated at the same address isn't mistaken for them.
+
+struct FilteredProgram : IGpuProgram
+{
+  FilteredProgram(StateFilter* filter, std::unique_ptr<IGpuProgram> inner) : filter(filter), inner(std::move(inner)) {}
+  ~FilteredProgram();
+
+  StateFilter* const filter;
+  std::unique_ptr<IGpuProgram> const inner;
+};
+
+struct FilteredVertexBuffer : IVertexBuffer
+{
+  FilteredVertexBuffer(StateFilter* filter, std::unique_ptr<IVertexBuffer> inner) : filter(filter), inner(std::move(inner)) {}
+  ~FilteredVertexBuffer();
+
+  void upload(const void* data, size_t len) override;
+  void update(size_t offset, const void* data, size_t len) override;
+
+  StateFilter* const filter;
+  std::unique_ptr<IVertexBuffer> const inner;
+};
+
+struct FilteredIndexBuffer : IIndexBuffer
+{
+  FilteredIndexBuffer(StateFilter* filter, std::unique_ptr<IIndexBuffer> inner) : filter(filter), inner(std::move(inner)) {}
+  ~FilteredIndexBuffer();
+
+  void upload(const void* data, int indexCount, int indexSize) override;
+
+  StateFilter* const filter;
+  std::unique_ptr<IIndexBuffer> const inner;
+};
+
+struct FilteredTexture : ITexture
+{
+  FilteredTexture(StateFilter* filter, std::unique_ptr<ITexture> owned) : filter(filter), owned(std::move(owned)), inner(this->owned.get()) {}
+  FilteredTexture(StateFilter* filter, ITexture* borrowed) : filter(filter), inner(borrowed) {}
+  ~FilteredTexture();
+
+  void upload(PictureView pic) override;
+  void uploadMipChain(CookedTexture const& tex, int firstLevel) override;
+  void setNoRepeat() override;
+  void bind(int unit) override;
+
+  StateFilter* const filter;
+  std::unique_ptr<ITexture> const owned; // null for the textures of the frame buffers
+  ITexture* const inner;
+};
+
+struct FilteredFrameBuffer : IFrameBuffer
+{
+  FilteredFrameBuffer(StateFilter* filter, std::unique_ptr<IFrameBuffer> inner)
+    : inner(std::move(inner)), colorTexture(filter, this->inner->getColorTexture())
+  {
+  }
+
+  ITexture* getColorTexture() override { return &colorTexture; }
+
+  std::unique_ptr<IFrameBuffer> const inner;
+  FilteredTexture colorTexture;
+};
+
+struct StateFilter : IStateFilter
+{
+  StateFilter(IGraphicsBackend* backend) : backend(backend) {}
+
+  int getIssuedCount() const override { return m_issued; }
+  int getSkippedCount() const override { return m_skipped; }
+
+  void setFullscreen(bool fs) override { backend->setFullscreen(fs); }
+  void setCaption(String caption) override { backend->setCaption(caption); }
+  void enableGrab(bool enable) override { backend->enableGrab(enable); }
+  void readPixels(Span<uint8_t> dstRgbPixels) override { backend->readPixels(dstRgbPixels); }
+
+  std::unique_ptr<ITexture> createTexture() override
+  {
+    return std::make_unique<FilteredTexture>(this, backend->createTexture());
+  }
+
+  std::unique_ptr<IVertexBuffer> createVertexBuffer(bool dynamic) override
+  {
+    return std::make_unique<FilteredVertexBuffer>(this, backend->createVertexBuffer(dynamic));
+  }
+
+  std::unique_ptr<IIndexBuffer> createIndexBuffer() override
+  {
+    return std::make_unique<FilteredIndexBuffer>(this, backend->createIndexBuffer());
+  }
+
+  std::unique_ptr<IFrameBuffer> createFrameBuffer(Vec2i resolution, bool depth) override
+  {
+    auto r = std::make_unique<FilteredFrameBuffer>(this, backend->createFrameBuffer(resolution, depth));
+    forgetTextureBindings(); // the backend might have bound the attachments
+    return r;
+  }
+
+  std::unique_ptr<IGpuProgram> createGpuProgram(String name, bool zTest) override
+  {
+    return std::make_unique<FilteredProgram>(this, backend->createGpuProgram(name, zTest));
+  }
+
+  void setScreenSizeListener(IScreenSizeListener* listener) override { backend->setScreenSizeListener(listener); }
+
+  void setRenderTarget(IFrameBuffer* fb) override
+  {
+    backend->setRenderTarget(fb ? static_cast<FilteredFrameBuffer*>(fb)->inner.get() : nullptr);
+  }
+
+  void useGpuProgram(IGpuProgram* program) override
+  {
+    if(!changeState(m_program, program))
+      return;
+
+    backend->useGpuProgram(static_cast<FilteredProgram*>(program)->inner.get());
+  }
+
+  void useVertexBuffer(IVertexBuffer* vb) override
+  {
+    if(!changeState(m_vertexBuffer, vb))
+      return;
+
+    backend->useVertexBuffer(static_cast<FilteredVertexBuffer*>(vb)->inner.get());
+  }
+
+  void useIndexBuffer(IIndexBuffer* ib) override
+  {
+    if(!changeState(m_indexBuffer, ib))
+      return;
+
+    backend->useIndexBuffer(static_cast<FilteredIndexBuffer*>(ib)->inner.get());
+  }
+
+  void enableVertexAttribute(int id, int dim, int stride, int offset, AttributeFormat format) override
+  {
+    if(!changeAttribute(id, { dim ? m_vertexBuffer : nullptr, dim, stride, offset, format, false }))
+      return;
+
+    backend->enableVertexAttribute(id, dim, stride, offset, format);
+  }
+
+  void enableInstanceAttribute(int id, int dim, int stride, int offset) override
+  {
+    if(!changeAttribute(id, { m_vertexBuffer, dim, stride, offset, AttributeFormat::Float, true }))
+      return;
+
+    backend->enableInstanceAttribute(id, dim, stride, offset);
+  }
+
+  void setUniformBlock(void* ptr, size_t size, int binding) override { backend->setUniformBlock(ptr, size, binding); }
+  void draw(int vertexCount, int firstVertex) override { backend->draw(vertexCount, firstVertex); }
+  void drawInstanced(int vertexCount, int instanceCount, int firstVertex) override { backend->drawInstanced(vertexCount, instanceCount, firstVertex); }
+  void drawIndexedInstanced(int indexCount, int instanceCount, int firstIndex) override { backend->drawIndexedInstanced(indexCount, instanceCount, firstIndex); }
+  void clear() override { backend->clear(); }
+
+  void swap() override
+  {
+    backend->swap();
+
+    ggStateChangesIssued = m_issued - m_issuedAtLastSwap;
+    ggStateChangesSkipped = m_skipped - m_skippedAtLastSwap;
+    m_issuedAtLastSwap = m_issued;
+    m_skippedAtLastSwap = m_skipped;
+  }
+
+  void bindTexture(FilteredTexture* texture, int unit)
+  {
+    assert(unit >= 0 && unit < MaxTextureUnits);
+
+    if(!changeState(m_textureUnits[unit], texture))
+      return;
+
+    texture->inner->bind(unit);
+  }
+
+  // the backend is allowed to use any texture unit to upload a texture
+  void forgetTextureBindings()
+  {
+    for(auto& unit : m_textureUnits)
+      unit = nullptr;
+  }
+
+  void forget(FilteredTexture* texture)
+  {
+    for(auto& unit : m_textureUnits)
+      if(unit == texture)
+        unit = nullptr;
+  }
+
+  void forget(FilteredVertexBuffer* vb)
+  {
+    if(m_vertexBuffer == vb)
+      m_vertexBuffer = nullptr;
+
+    for(auto& attrib : m_attributes)
+      if(attrib.vb == vb)
+        attrib = {};
+  }
+
+  void forget(FilteredIndexBuffer* ib)
+  {
+    if(m_indexBuffer == ib)
+      m_indexBuffer = nullptr;
+  }
+
+  void forget(FilteredProgram* program)
+  {
+    if(m_program == program)
+      m_program = nullptr;
+  }
+
+  // the backend might unbind the vertex buffer to upload one
+  void forgetVertexBuffer()
+  {
+    m_vertexBuffer = nullptr;
+  }
+
+  void forgetIndexBuffer()
+  {
+    m_indexBuffer = nullptr;
+  }
+
+private:
+  struct Attribute
+  {
+    IVertexBuffer* vb = nullptr;
+    int dim = -1; // unknown
+    int stride = 0;
+    int offset = 0;
+    AttributeFormat format = AttributeFormat::Float;
+    bool perInstance = false;
+
+    bool operator == (Attribute const& other) const
+    {
+      return vb == other.vb && dim == other.dim && stride == other.stride && offset == other.offset && format == other.format && perInstance == other.perInstance;
+    }
+  };
+
+  // Returns false if the call can be skipped
+  template<typename T>
+  bool changeState(T& curr, T next)
+  {
+    if(curr == next)
+    {
+      ++m_skipped;
+      return false;
+    }
+
+    curr = next;
+    ++m_issued;
+    return true;
+  }
+
+  bool changeAttribute(int id, Attribute attrib)
+  {
+    assert(id >= 0 && id < MaxVertexAttributes);
+    return changeState(m_attributes[id], attrib);
+  }
+
+  IGraphicsBackend* const backend;
+
+  IGpuProgram* m_program = nullptr;
+  IVertexBuffer* m_vertexBuffer = nullptr;
+  IIndexBuffer* m_indexBuffer = nullptr;
+  Attribute m_attributes[MaxVertexAttributes];
+  FilteredTexture* m_textureUnits[MaxTextureUnits] {};
+
+  int m_issued = 0;
+  int m_skipped = 0;
+  int m_issuedAtLastSwap = 0;
+  int m_skippedAtLastSwap = 0;
+};
+
+FilteredProgram::~FilteredProgram()
+{
+  filter->forget(this);
+}
+
+FilteredVertexBuffer::~FilteredVertexBuffer()
+{
+  filter->forget(this);
+}
+
+void FilteredVertexBuffer::upload(const void* data, size_t len)
+{
+  inner->upload(data, len);
+  filter->forgetVertexBuffer();
+}
+
+void FilteredVertexBuffer::update(size_t offset, const void* data, size_t len)
+{
+  inner->update(offset, data, len);
+  filter->forgetVertexBuffer();
+}
+
+FilteredIndexBuffer::~FilteredIndexBuffer()
+{
+  filter->forget(this);
+}
+
+void FilteredIndexBuffer::upload(const void* data, int indexCount, int indexSize)
+{
+  inner->upload(data, indexCount, indexSize);
+  filter->forgetIndexBuffer();
+}
+
+FilteredTexture::~FilteredTexture()
+{
+  filter->forget(this);
+}
+
+void FilteredTexture::upload(PictureView pic)
+{
+  inner->upload(pic);
+  filter->forgetTextureBindings();
+}
+
+void FilteredTexture::uploadMipChain(CookedTexture const& tex, int firstLevel)
+{
+  inner->uploadMipChain(tex, firstLevel);
+  filter->forgetTextureBindings();
+}
+
+void FilteredTexture::setNoRepeat()
+{
+  inner->setNoRepeat();
+  filter->forgetTextureBindings();
+}
+
+void FilteredTexture::bind(int unit)
+{
+  filter->bindTexture(this, unit);
+}
+}
+
+std::unique_ptr<IStateFilter> createStateFilter(IGraphicsBackend* backend)
+{
+  return std::make_unique<StateFilter>(backend);
+}
@@ -0,0 +1,76 @@
+// Copyright (C) 2026 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+#include "streaming_buffer.h"
+
+#include "engine/graphics_backend.h"
+#include <algorithm> // max
+
+StreamingVertexBuffer::StreamingVertexBuffer(IGraphicsBackend* backend, int capacity)
+  : m_vb(backend->createVertexBuffer(true))
+  , m_capacity(capacity)
+{
+  m_vb->upload(nullptr, m_capacity);
+
+  for(auto& start : m_frameStarts)
+    start = -1;
+}
+
+void StreamingVertexBuffer::beginFrame()
+{
+  m_frame = (m_frame + 1) % FramesInFlight;
+  m_frameStarts[m_frame] = m_head;
+}
+
+int StreamingVertexBuffer::push(const void* data, int len, int alignment)
+{
+  // start of the oldest frame in flight
+  int tail = -1;
+
+  for(int i = 1; i <= FramesInFlight && tail < 0; ++i)
+    tail = m_frameStarts[(m_frame + i) % FramesInFlight];
+
+  int pos = (m_head + alignment - 1) / alignment * alignment;
+
+  // wrap around
+  if(!isFree(pos, len, tail))
+    pos = 0;
+
+  if(!isFree(pos, len, tail))
+  {
+    // Orphans the current storage: the draw calls already issued keep reading it
+    m_capacity = std::max(m_capacity * 2, len);
+    m_vb->upload(nullptr, m_capacity);
+
+    for(auto& start : m_frameStarts)
+      start = -1;
+
+    m_frameStarts[m_frame] = 0;
+    pos = 0;
+  }
+
+  m_vb->update(pos, data, len);
+  m_head = pos + len;
+
+  return pos;
+}
+
+bool StreamingVertexBuffer::isFree(int pos, int len, int tail) const
+{
+  if(pos + len > m_capacity)
+    return false;
+
+  // nothing in flight
+  if(tail < 0 || tail == m_head)
+    return true;
+
+  // The frames in flight use [tail;head[, or [tail;capacity[ and [0;head[ once wrapped around.
+  // The head never catches up with the tail: 'tail == head' means empty.
+  if(pos >= m_head)
+    return tail < m_head || pos + len < tail;
+  else
+    return tail < m_head && pos + len < tail;
+}
@@ -0,0 +1,49 @@
+// Copyright (C) 2026 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+// Dynamic vertex buffer for the vertices rebuilt every frame.
+// The storage is allocated once, and written as a ring: each batch goes
+// after the previous one. A part of the ring only gets overwritten once the
+// frames that used it are 'FramesInFlight' frames old, so the GPU is done
+// reading it. When that's not possible, the ring grows.
+
+#pragma once
+
+#include <memory>
+
+struct IGraphicsBackend;
+struct IVertexBuffer;
+
+struct StreamingVertexBuffer
+{
+  // Frames the GPU can be late on the CPU
+  static constexpr int FramesInFlight = 3;
+
+  StreamingVertexBuffer(IGraphicsBackend* backend, int capacity);
+
+  // Call once per frame, before the first 'push'
+  void beginFrame();
+
+  // Copies 'len' bytes to the ring, and returns their offset.
+  // The offset is a multiple of 'alignment', e.g the vertex size,
+  // so the draw calls can start at the vertex 'offset / alignment'.
+  int push(const void* data, int len, int alignment);
+
+  IVertexBuffer* get() const { return m_vb.get(); }
+  int getCapacity() const { return m_capacity; }
+
+private:
+  bool isFree(int pos, int len, int tail) const;
+
+  std::unique_ptr<IVertexBuffer> m_vb;
+  int m_capacity;
+  int m_head = 0; // where the next batch goes
+
+  // Where each of the frames in flight started writing, -1 if unused.
+  // The current frame is 'm_frame'.
+  int m_frameStarts[FramesInFlight];
+  int m_frame = 0;
+};
@@ -0,0 +1,371 @@
+// Copyright (C) 2026 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+#include "texture_streaming.h"
+
+#include <algorithm> // max, min, sort
+#include <cmath> // log2, floor
+#include <cstdio>
+#include <queue>
+#include <stdexcept>
+#include <utility> // pair
+#include <vector>
+
+#include "base/error.h"
+#include "engine/cooked_texture.h"
+#include "engine/graphics_backend.h"
+#include "misc/file.h"
+#include "misc/job_queue.h"
+#include "misc/stats.h"
+#include "picture.h"
+
+namespace
+{
+Gauge ggTextureResidentMegabytes("Texture memory (MB)");
+Gauge ggTexturePendingUploads("Texture uploads pending");
+Gauge ggTextureBudgetPressure("Texture budget pressure (%)");
+
+// Levels up to this size are always resident
+const int CoarseSize = 64;
+
+// Each load reads a whole texture file
+const int MaxLoadsPerFrame = 2;
+
+// The file contents, read and parsed by a worker thread
+struct LoadedFile
+{
+  std::string data;
+  CookedTexture tex;
+  std::string error; // empty on success
+};
+}
+
+struct TextureStreamer::StreamedTexture : ITexture
+{
+  ~StreamedTexture()
+  {
+    streamer->m_textures.erase(this);
+  }
+
+  void upload(PictureView pic) override { inner->upload(pic); }
+  void uploadMipChain(CookedTexture const& tex, int firstLevel) override { inner->uploadMipChain(tex, firstLevel); }
+  void setNoRepeat() override { inner->setNoRepeat(); }
+  void bind(int unit) override { inner->bind(unit); }
+
+  bool isLoaded() const { return levelCount > 0; }
+
+  // size of the levels 'level' and coarser
+  int64_t getBytes(int level) const
+  {
+    int64_t r = 0;
+
+    for(int i = std::max(level, 0); i < levelCount; ++i)
+    {
+      const auto levelDim = getMipLevelSize(dim, i);
+      r += int64_t(levelDim.x) * levelDim.y * 4 * layerCount;
+    }
+
+    return r;
+  }
+
+  // resident, or being loaded
+  int getCommittedLevel() const
+  {
+    return loadingLevel >= 0 ? std::min(residentLevel, loadingLevel) : residentLevel;
+  }
+
+  TextureStreamer* streamer;
+  int id; // pointers get reused: this tells the textures apart
+  std::unique_ptr<ITexture> inner;
+  std::string path;
+  Delegate<void(int64_t)> onLoaded;
+
+  // known once loaded
+  Vec2i dim {};
+  int layerCount = 0;
+  int levelCount = 0;
+  int coarseLevel = 0; // always resident
+
+  int residentLevel = -1; // finest level uploaded
+  int loadingLevel = -1; // finest level of the load in progress, -1 if none
+  int wantedLevel = 0; // finest level needed by the requests of this frame
+  int targetLevel = 0; // what 'update' aims for
+  bool broken = false; // the file can't be read anymore: stick to what's resident
+};
+
+TextureStreamer::TextureStreamer(IGraphicsBackend* backend, JobQueue* jobs) : readFile(&File::read), backend(backend), jobs(jobs)
+{
+}
+
+std::unique_ptr<ITexture> TextureStreamer::createTexture(String path, Delegate<void(int64_t bytes)> onLoaded)
+{
+  auto r = std::make_unique<StreamedTexture>();
+  r->streamer = this;
+  r->id = m_nextId++;
+  r->inner = backend->createTexture();
+  r->path.assign(path.data, path.len);
+  r->onLoaded = std::move(onLoaded);
+
+  uploadPlaceholderTexture(r->inner.get());
+
+  m_textures[r.get()] = r.get();
+
+  // the coarse level isn't known yet
+  loadLevels(r.get(), -1);
+
+  return r;
+}
+
+void TextureStreamer::request(ITexture* texture, float uvPerPixel)
+{
+  auto i = m_textures.find(texture);
+
+  if(i == m_textures.end())
+    return;
+
+  auto t = i->second;
+
+  if(t->broken || !t->isLoaded())
+    return;
+
+  // one texel per pixel
+  const float texelsPerPixel = uvPerPixel * std::max(t->dim.x, t->dim.y);
+  const int level = texelsPerPixel > 1 ? std::min((int)floor(log2(texelsPerPixel)), t->coarseLevel) : 0;
+
+  t->wantedLevel = std::min(t->wantedLevel, level);
+}
+
+void TextureStreamer::update()
+{
+  std::vector<StreamedTexture*> textures;
+
+  for(auto& entry : m_textures)
+    if(entry.second->isLoaded())
+      textures.push_back(entry.second);
+
+  auto isBusy = [] (StreamedTexture* t) { return t->broken || t->loadingLevel >= 0; };
+
+  // What this frame needs. When it doesn't fit, the finest level of the
+  // biggest textures gets dropped first.
+  int64_t neededBytes = 0;
+
+  for(auto t : textures)
+  {
+    t->targetLevel = isBusy(t) ? t->getCommittedLevel() : t->wantedLevel;
+    neededBytes += t->getBytes(t->targetLevel);
+  }
+
+  ggTextureBudgetPressure = budget > 0 ? neededBytes * 100.0 / budget : 0;
+
+  {
+    auto getFinestLevelBytes = [] (StreamedTexture* t) { return t->getBytes(t->targetLevel) - t->getBytes(t->targetLevel + 1); };
+
+    std::priority_queue<std::pair<int64_t, StreamedTexture*>> biggest;
+
+    for(auto t : textures)
+      if(t->targetLevel < t->coarseLevel && !isBusy(t))
+        biggest.push({ getFinestLevelBytes(t), t });
+
+    while(neededBytes > budget && !biggest.empty())
+    {
+      auto t = biggest.top().second;
+      biggest.pop();
+
+      neededBytes -= getFinestLevelBytes(t);
+      ++t->targetLevel;
+
+      if(t->targetLevel < t->coarseLevel)
+        biggest.push({ getFinestLevelBytes(t), t });
+    }
+  }
+
+  int64_t residentBytes = 0;
+  int loading = 0;
+
+  for(auto t : textures)
+  {
+    residentBytes += t->getBytes(t->getCommittedLevel());
+
+    if(t->loadingLevel >= 0)
+      ++loading;
+  }
+
+  // the textures missing levels, the ones missing the most first
+  std::vector<StreamedTexture*> missing;
+  int64_t missingBytes = 0;
+
+  for(auto t : textures)
+  {
+    if(!isBusy(t) && t->residentLevel > t->targetLevel)
+    {
+      missing.push_back(t);
+      missingBytes += t->getBytes(t->targetLevel) - t->getBytes(t->residentLevel);
+    }
+  }
+
+  std::sort(missing.begin(), missing.end(), [] (StreamedTexture* a, StreamedTexture* b)
+    {
+      return a->residentLevel - a->targetLevel > b->residentLevel - b->targetLevel;
+    });
+
+  int loads = 0;
+
+  // Make room by dropping the levels that aren't needed anymore.
+  // Otherwise, they stay resident until the memory is needed.
+  for(auto t : textures)
+  {
+    if(residentBytes + missingBytes <= budget || loads >= MaxLoadsPerFrame)
+      break;
+
+    if(!isBusy(t) && t->residentLevel < t->targetLevel)
+    {
+      residentBytes -= t->getBytes(t->residentLevel) - t->getBytes(t->targetLevel);
+      loadLevels(t, t->targetLevel);
+      ++loads;
+    }
+  }
+
+  int pending = 0;
+
+  for(auto t : missing)
+  {
+    const auto growth = t->getBytes(t->targetLevel) - t->getBytes(t->residentLevel);
+
+    if(loads >= MaxLoadsPerFrame || residentBytes + growth > budget)
+    {
+      ++pending;
+      continue;
+    }
+
+    residentBytes += growth;
+    loadLevels(t, t->targetLevel);
+    ++loads;
+  }
+
+  ggTexturePendingUploads = pending + loading;
+  ggTextureResidentMegabytes = residentBytes / (1024.0 * 1024.0);
+
+  for(auto t : textures)
+    t->wantedLevel = t->coarseLevel;
+}
+
+// 'firstLevel' = -1: the coarse level
+void TextureStreamer::loadLevels(StreamedTexture* t, int firstLevel)
+{
+  auto file = std::make_shared<LoadedFile>();
+  auto path = t->path;
+  auto id = t->id;
+
+  t->loadingLevel = std::max(firstLevel, 0);
+
+  auto work = [this, file, path] ()
+    {
+      try
+      {
+        file->data = readFile(path);
+        file->tex = parseCookedTexture({ (const uint8_t*)file->data.data(), (int)file->data.size() });
+      }
+      catch(std::exception const& e)
+      {
+        file->error = e.what();
+      }
+      catch(Error const& e)
+      {
+        // e.g missing file
+        const auto msg = e.message();
+        file->error.assign(msg.data, msg.len);
+      }
+    };
+
+  auto done = [this, file, path, t, id, firstLevel] ()
+    {
+      auto i = m_textures.find(t);
+
+      // destroyed in the meantime
+      if(i == m_textures.end() || t->id != id)
+        return;
+
+      t->loadingLevel = -1;
+
+      auto const& tex = file->tex;
+
+      if(file->error.empty() && t->isLoaded())
+      {
+        if(tex.dim.x != t->dim.x || tex.dim.y != t->dim.y || tex.layerCount != t->layerCount || tex.levelCount != t->levelCount)
+          file->error = "Texture changed on disk";
+      }
+
+      if(!file->error.empty())
+      {
+        printf("[display] can't load texture '%s' (%s)\n", path.c_str(), file->error.c_str());
+        t->broken = true;
+        return;
+      }
+
+      if(!t->isLoaded())
+      {
+        t->dim = tex.dim;
+        t->layerCount = tex.layerCount;
+        t->levelCount = tex.levelCount;
+
+        while(t->coarseLevel + 1 < tex.levelCount)
+        {
+          const auto levelDim = getMipLevelSize(tex.dim, t->coarseLevel);
+
+          if(std::max(levelDim.x, levelDim.y) <= CoarseSize)
+            break;
+
+          ++t->coarseLevel;
+        }
+
+        t->wantedLevel = t->coarseLevel;
+        printf("[display] loaded texture '%s'\n", path.c_str());
+      }
+
+      const int level = firstLevel < 0 ? t->coarseLevel : firstLevel;
+      t->inner->uploadMipChain(tex, level);
+      t->residentLevel = level;
+
+      if(firstLevel < 0 && t->onLoaded)
+        t->onLoaded(t->getBytes(0));
+    };
+
+  jobs->push(work, done);
+}
+
+int TextureStreamer::getResidentLevel(ITexture* texture) const
+{
+  auto i = m_textures.find(texture);
+  return i == m_textures.end() ? -1 : i->second->residentLevel;
+}
+
+int64_t TextureStreamer::getResidentBytes() const
+{
+  int64_t r = 0;
+
+  for(auto& entry : m_textures)
+    r += entry.second->getBytes(entry.second->residentLevel);
+
+  return r;
+}
+
+void uploadPlaceholderTexture(ITexture* texture)
+{
+  static std::vector<uint8_t> data;
+
+  if(data.empty())
+  {
+    auto pic = generatedPicture();
+
+    TextureImage layer;
+    layer.dim = pic.dim;
+    layer.pixels = std::move(pic.pixels);
+
+    data = cookTexture({ &layer, 1 });
+  }
+
+  texture->uploadMipChain(parseCookedTexture(data));
+}
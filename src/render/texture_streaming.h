@@ -0,0 +1,68 @@
+// Copyright (C) 2026 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+// Mip level streaming for the cooked textures.
+// A texture starts with its coarse levels only. The finer levels get uploaded
+// when its meshes come closer to the camera, and are dropped again when
+// the resident levels of all the textures don't fit in the memory budget.
+// The files are read in the background: until then, textures show the placeholder.
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "base/delegate.h"
+#include "base/string.h"
+
+struct IGraphicsBackend;
+struct ITexture;
+struct JobQueue;
+
+struct TextureStreamer
+{
+  TextureStreamer(IGraphicsBackend* backend, JobQueue* jobs);
+
+  // Returns a texture showing the placeholder, until the coarse levels
+  // of the cooked texture at 'path' are loaded. Then, 'onLoaded' gets called
+  // with the size of all the levels.
+  // If the file can't be loaded, the texture keeps the placeholder.
+  // The texture must not outlive the streamer.
+  std::unique_ptr<ITexture> createTexture(String path, Delegate<void(int64_t bytes)> onLoaded = {});
+
+  // 'texture' gets drawn this frame, with 'uvPerPixel' texture coordinate units
+  // per screen pixel. Textures not created by the streamer are ignored.
+  void request(ITexture* texture, float uvPerPixel);
+
+  // Starts loading or dropping the levels needed by the requests of this frame,
+  // at most 'MaxLoadsPerFrame' textures at a time. Call once per frame.
+  void update();
+
+  // finest level uploaded, -1 if 'texture' isn't streamed or isn't loaded yet
+  int getResidentLevel(ITexture* texture) const;
+  int64_t getResidentBytes() const;
+
+  int64_t budget = int64_t(256) << 20; // in bytes
+
+  // reads the cooked textures, from the worker threads
+  Delegate<std::string(String)> readFile;
+
+  struct StreamedTexture;
+
+private:
+  void loadLevels(StreamedTexture* texture, int firstLevel);
+
+  IGraphicsBackend* const backend;
+  JobQueue* const jobs;
+  std::unordered_map<ITexture*, StreamedTexture*> m_textures;
+  int m_nextId = 0;
+};
+
+// The generated picture, as a one-layer texture array (the mesh shader samples arrays).
+// Stands for the textures being loaded, and for the ones that can't be loaded.
+void uploadPlaceholderTexture(ITexture* texture);
@@ -0,0 +1,115 @@
+// Copyright (C) 2026 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+#include "engine/cooked_texture.h"
+#include "tests.h"
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+// 3x2 pixels: a red row on top, a blue row below
+const uint8_t redOverBluePng[] =
+{
+    0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a, 0x00, 0x00, 0x00, 0x0d,
+    0x49, 0x48, 0x44, 0x52, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x02,
+    0x08, 0x06, 0x00, 0x00, 0x00, 0x9d, 0x74, 0x66, 0x1a, 0x00, 0x00, 0x00,
+    0x12, 0x49, 0x44, 0x41, 0x54, 0x78, 0x9c, 0x63, 0xf8, 0xcf, 0xc0, 0xf0,
+    0x1f, 0x86, 0x19, 0x90, 0xd8, 0xff, 0x01, 0x95, 0x84, 0x0b, 0xf5, 0x8b,
+    0x45, 0x4a, 0x49, 0x00, 0x00, 0x00, 0x00, 0x49, 0x45, 0x4e, 0x44, 0xae,
+    0x42, 0x60, 0x82,
+};
+
+std::vector<uint8_t> cookPng(Span<const uint8_t> pngData)
+{
+  TextureImage layer = decodeTextureImage(pngData);
+  return cookTexture({ &layer, 1 });
+}
+
+bool isInvalid(std::vector<uint8_t> const& data)
+{
+  try
+  {
+    parseCookedTexture(data);
+    return false;
+  }
+  catch(std::runtime_error const&)
+  {
+    return true;
+  }
+}
+}
+
+unittest("CookedTexture: mip level sizes")
+{
+  assertEquals(1, getMipLevelCount(Vec2i(1, 1)));
+  assertEquals(9, getMipLevelCount(Vec2i(256, 256)));
+  assertEquals(9, getMipLevelCount(Vec2i(256, 4)));
+  assertEquals(64, getMipLevelSize(Vec2i(256, 4), 2).x);
+  assertEquals(1, getMipLevelSize(Vec2i(256, 4), 2).y);
+  assertEquals(1, getMipLevelSize(Vec2i(256, 4), 8).x);
+}
+
+unittest("CookedTexture: flipped, with mip levels")
+{
+  auto data = cookPng(redOverBluePng);
+  auto tex = parseCookedTexture(data);
+
+  assertEquals(1, tex.layerCount);
+  assertEquals(3, tex.dim.x);
+  assertEquals(2, tex.dim.y);
+  assertEquals(2, tex.levelCount);
+  assertEquals((3 * 2 + 1 * 1) * 4, tex.texels.len);
+
+  // level 0: bottom row first
+  const std::vector<uint8_t> blue = { 0, 0, 255, 255 };
+  const std::vector<uint8_t> red = { 255, 0, 0, 255 };
+  assertEquals(blue, std::vector<uint8_t>(tex.texels.data + 0, tex.texels.data + 4));
+  assertEquals(red, std::vector<uint8_t>(tex.texels.data + 12, tex.texels.data + 16));
+
+  // level 1: average
+  const std::vector<uint8_t> purple = { 128, 0, 128, 255 };
+  assertEquals(purple, std::vector<uint8_t>(tex.texels.data + 24, tex.texels.data + 28));
+}
+
+unittest("CookedTexture: texture arrays")
+{
+  TextureImage layers[2];
+
+  for(int i = 0; i < 2; ++i)
+  {
+    layers[i].dim = Vec2i(2, 2);
+    layers[i].pixels.assign(2 * 2 * 4, i == 0 ? 10 : 20);
+  }
+
+  auto data = cookTexture(layers);
+  auto tex = parseCookedTexture(data);
+
+  assertEquals(2, tex.layerCount);
+  assertEquals(2, tex.levelCount);
+  assertEquals((2 * 2 + 1 * 1) * 4 * 2, tex.texels.len);
+
+  // level by level, the layers of each level one after another
+  assertEquals(10, (int)tex.texels.data[0]);
+  assertEquals(20, (int)tex.texels.data[16]);
+  assertEquals(10, (int)tex.texels.data[32]);
+  assertEquals(20, (int)tex.texels.data[36]);
+}
+
+unittest("CookedTexture: reject invalid data")
+{
+  auto data = cookPng(redOverBluePng);
+
+  assertTrue(!isInvalid(data));
+
+  auto truncated = data;
+  truncated.pop_back();
+  assertTrue(isInvalid(truncated));
+
+  auto badMagic = data;
+  badMagic[0] = 'X';
+  assertTrue(isInvalid(badMagic));
+}
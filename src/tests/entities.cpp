@@ -2,6 +2,7 @@
 
 #include "entities/bonus.h"
 #include "entities/explosion.h"
+#include "gameplay/entity_factory.h"
 
 #include "tests.h"
 
@@ -103,3 +104,12 @@ unittest("Entity: pickup bonus")
   assertEquals(4, player.upgrades);
 }
 
+unittest("Entity: factory type ids")
+{
+  auto bonus = findEntityType("bonus");
+  auto door = findEntityType("door");
+
+  assertEquals(bonus, findEntityType("bonus"));
+  assertTrue(bonus != door);
+  assertThrown(findEntityType("no_such_entity"));
+}
@@ -0,0 +1,60 @@
+// Copyright (C) 2026 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+#include "misc/job_queue.h"
+#include "tests.h"
+#include <atomic>
+#include <thread>
+
+unittest("JobQueue: completions run from poll")
+{
+  for(int workerCount : { 0, 3 })
+  {
+    std::atomic<int> worked(0);
+    int completed = 0;
+
+    {
+      JobQueue jobs(workerCount);
+      assertEquals(workerCount, jobs.getWorkerCount());
+
+      const auto mainThread = std::this_thread::get_id();
+
+      for(int i = 0; i < 10; ++i)
+      {
+        jobs.push([&] () { ++worked; }, [&] ()
+          {
+            assertTrue(std::this_thread::get_id() == mainThread);
+            ++completed;
+          });
+      }
+
+      // nothing completes behind our back
+      assertEquals(0, completed);
+
+      while(jobs.poll(1000000) > 0)
+        std::this_thread::yield();
+    }
+
+    assertEquals(10, (int)worked);
+    assertEquals(10, completed);
+  }
+}
+
+unittest("JobQueue: the upload budget spreads the completions over several polls")
+{
+  JobQueue jobs(0);
+  int completed = 0;
+
+  for(int i = 0; i < 3; ++i)
+    jobs.push([] () {}, [&] () { ++completed; });
+
+  // at least one per poll
+  assertEquals(2, jobs.poll(0));
+  assertEquals(1, completed);
+
+  assertEquals(0, jobs.poll(1000000));
+  assertEquals(3, completed);
+}
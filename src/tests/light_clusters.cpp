@@ -0,0 +1,89 @@
+// Copyright (C) 2026 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+#include "render/light_clusters.h"
+#include "tests.h"
+#include <memory>
+
+namespace
+{
+// Light indices of the cluster at 'x', 'y', of the slice containing 'depth'
+std::vector<int> getLights(LightClusters const& clusters, int x, int y, float depth)
+{
+  const auto range = clusters.uniforms.ranges[LightClusters::getClusterIndex(x, y, LightClusters::getSlice(depth))];
+  const int first = range & 0xFFFF;
+  const int count = range >> 16;
+
+  std::vector<int> r;
+
+  for(int i = first; i < first + count; ++i)
+    r.push_back(clusters.uniforms.indices[i]);
+
+  return r;
+}
+}
+
+unittest("LightClusters: depth slices")
+{
+  assertEquals(0, LightClusters::getSlice(0));
+  assertEquals(0, LightClusters::getSlice(0.1));
+  assertEquals(LightClusters::SizeZ / 2, LightClusters::getSlice(3.2)); // sqrt(0.1 * 100) = 3.16
+  assertEquals(LightClusters::SizeZ - 1, LightClusters::getSlice(1000));
+}
+
+unittest("LightClusters: lights only go to the clusters they reach")
+{
+  auto clusters = std::make_unique<LightClusters>();
+  clusters->begin(1, 1); // 90 degrees
+
+  assertTrue(clusters->addLight(Vec3f(0, 0, -10), 1)); // center of the screen
+  assertTrue(clusters->addLight(Vec3f(-8, 8, -10), 1)); // top left
+  assertTrue(!clusters->addLight(Vec3f(0, 0, 10), 1)); // behind the camera
+  assertTrue(!clusters->addLight(Vec3f(50, 0, -10), 1)); // right of the view
+  assertTrue(clusters->addLight(Vec3f(0, 0, 5), 10)); // behind, but reaching the front
+  clusters->end();
+
+  assertEquals(3, clusters->getLightCount());
+
+  auto center = getLights(*clusters, LightClusters::SizeX / 2, LightClusters::SizeY / 2, 10);
+  assertEquals(1, (int)center.size());
+  assertEquals(0, center[0]);
+
+  auto topLeft = getLights(*clusters, 0, LightClusters::SizeY - 1, 10);
+  assertEquals(1, (int)topLeft.size());
+  assertEquals(1, topLeft[0]);
+
+  // too far for both
+  assertEquals(0, (int)getLights(*clusters, LightClusters::SizeX / 2, LightClusters::SizeY / 2, 50).size());
+
+  auto near = getLights(*clusters, 0, 0, 1);
+  assertEquals(1, (int)near.size());
+  assertEquals(2, near[0]);
+}
+
+unittest("LightClusters: more lights than a uniform block holds")
+{
+  auto clusters = std::make_unique<LightClusters>();
+  clusters->begin(1, 1);
+
+  // all of them reach the whole view
+  for(int i = 0; i < LightClusters::MaxLights; ++i)
+    assertTrue(clusters->addLight(Vec3f(0, 0, -1), 1000));
+
+  assertTrue(!clusters->addLight(Vec3f(0, 0, -1), 1000));
+  clusters->end();
+
+  // the first clusters get all the lights, the indices run out for the last ones
+  assertEquals(int(LightClusters::MaxLights), (int)getLights(*clusters, 0, 0, 0).size());
+  assertEquals(0, (int)getLights(*clusters, LightClusters::SizeX - 1, LightClusters::SizeY - 1, 1000).size());
+
+  int total = 0;
+
+  for(auto range : clusters->uniforms.ranges)
+    total += range >> 16;
+
+  assertEquals(int(LightClusters::MaxIndices), total);
+}
@@ -0,0 +1,154 @@
+// Copyright (C) 2026 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+#include "base/matrix4.h"
+#include "tests.h"
+#include <cmath>
+#include <vector>
+
+namespace
+{
+const float Tolerance = 1e-5;
+
+float maxError(Matrix4f const& a, Matrix4f const& b)
+{
+  float r = 0;
+
+  for(int row = 0; row < 4; ++row)
+    for(int col = 0; col < 4; ++col)
+      r = std::max(r, (float)fabs(a[row][col] - b[row][col]));
+
+  return r;
+}
+
+Matrix4f someTransform(float angle)
+{
+  const auto q = Quaternion::fromEuler(angle, angle * 0.3, -angle * 0.7);
+  return translate(Vec3f(1.5, -2, 3)) * quaternionToMatrix(q) * scale(Vec3f(2, 0.5, 3));
+}
+}
+
+unittest("Matrix4: multiply")
+{
+  const auto m = translate(Vec3f(1, 2, 3)) * scale(Vec3f(2, 2, 2));
+  const auto p = m * Vec4f { 1, 1, 1, 1 };
+
+  assertEquals(3.0f, p.x);
+  assertEquals(4.0f, p.y);
+  assertEquals(5.0f, p.z);
+  assertEquals(1.0f, p.w);
+}
+
+unittest("Matrix4: transpose")
+{
+  Matrix4f m;
+
+  for(int row = 0; row < 4; ++row)
+    for(int col = 0; col < 4; ++col)
+      m[row][col] = row * 4 + col;
+
+  const auto t = transpose(m);
+
+  for(int row = 0; row < 4; ++row)
+    for(int col = 0; col < 4; ++col)
+      assertEquals(m[row][col], t[col][row]);
+}
+
+unittest("Matrix4: invert standard matrix")
+{
+  // rotation + translation: the inverse brings back the identity
+  const auto m = translate(Vec3f(1, -2, 5)) * quaternionToMatrix(Quaternion::fromEuler(0.3, 0.2, 0.1));
+  const auto identity = translate(Vec3f(0, 0, 0));
+  assertTrue(maxError(identity, m * invertStandardMatrix(m)) < Tolerance);
+}
+
+unittest("Matrix4: quaternion to matrix")
+{
+  // the matrix rotates the other way around
+  const auto q = Quaternion::rotation(Vec3f(0, 0, 1), PI / 2);
+  const auto v = quaternionToMatrix(q) * Vec4f { 1, 0, 0, 0 };
+
+  assertTrue(fabs(v.x - 0) < Tolerance);
+  assertTrue(fabs(v.y + 1) < Tolerance);
+  assertTrue(fabs(v.z - 0) < Tolerance);
+
+  // same as rotating with the conjugate
+  const auto q2 = Quaternion::fromEuler(0.4, -0.2, 1.1);
+  const auto expected = q2.conjugate().rotate(Vec3f(1, 2, 3));
+  const auto actual = quaternionToMatrix(q2) * Vec4f { 1, 2, 3, 0 };
+
+  assertTrue(fabs(expected.x - actual.x) < Tolerance);
+  assertTrue(fabs(expected.y - actual.y) < Tolerance);
+  assertTrue(fabs(expected.z - actual.z) < Tolerance);
+}
+
+unittest("Matrix4: batched transforms")
+{
+  struct Vertex
+  {
+    float x, y, z;
+    float nx, ny, nz;
+    float u, v;
+  };
+
+  const auto m = someTransform(0.7);
+
+  std::vector<Vertex> vertices;
+
+  for(int i = 0; i < 10; ++i)
+    vertices.push_back({ float(i), float(i * 2), float(-i), 0, 0, 1, 0.5, 0.25 });
+
+  auto expected = vertices;
+
+  transformPoints(m, &vertices[0].x, vertices.size(), sizeof(Vertex));
+  transformDirections(m, &vertices[0].nx, vertices.size(), sizeof(Vertex));
+
+  for(int i = 0; i < (int)vertices.size(); ++i)
+  {
+    const auto p = m * Vec4f { expected[i].x, expected[i].y, expected[i].z, 1 };
+    const auto n = m * Vec4f { expected[i].nx, expected[i].ny, expected[i].nz, 0 };
+
+    assertTrue(fabs(p.x - vertices[i].x) < Tolerance);
+    assertTrue(fabs(p.y - vertices[i].y) < Tolerance);
+    assertTrue(fabs(p.z - vertices[i].z) < Tolerance);
+    assertTrue(fabs(n.x - vertices[i].nx) < Tolerance);
+    assertTrue(fabs(n.y - vertices[i].ny) < Tolerance);
+    assertTrue(fabs(n.z - vertices[i].nz) < Tolerance);
+
+    // untouched
+    assertEquals(0.5f, vertices[i].u);
+    assertEquals(0.25f, vertices[i].v);
+  }
+}
+
+#if MATRIX4_SIMD
+unittest("Matrix4: SIMD kernels match the scalar ones")
+{
+  namespace scalar = matrix4::scalar;
+  namespace simd = matrix4::simd;
+
+  for(int i = 0; i < 100; ++i)
+  {
+    const auto a = someTransform(i * 0.1);
+    const auto b = someTransform(i * 0.37 + 1);
+    const auto q = Quaternion::fromEuler(i * 0.1, i * 0.2, i * 0.3);
+
+    assertTrue(maxError(scalar::multiply(a, b), simd::multiply(a, b)) < Tolerance * 10);
+    assertTrue(maxError(scalar::transpose(a), simd::transpose(a)) == 0);
+    assertTrue(maxError(scalar::invertStandardMatrix(a), simd::invertStandardMatrix(a)) < Tolerance);
+    assertTrue(maxError(scalar::quaternionToMatrix(q), simd::quaternionToMatrix(q)) < Tolerance);
+
+    const Vec4f v = { 1.0f * i, -2, 0.5, 1 };
+    const auto expected = scalar::transform(a, v);
+    const auto actual = simd::transform(a, v);
+
+    assertTrue(fabs(expected.x - actual.x) < Tolerance * 10);
+    assertTrue(fabs(expected.y - actual.y) < Tolerance * 10);
+    assertTrue(fabs(expected.z - actual.z) < Tolerance * 10);
+    assertTrue(fabs(expected.w - actual.w) < Tolerance * 10);
+  }
+}
+#endif
@@ -0,0 +1,122 @@
+// Copyright (C) 2026 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+#include "misc/mesh_simplify.h"
+#include "tests.h"
+#include <cmath>
+#include <vector>
+
+namespace
+{
+// N x N quads in the XY plane, facing +Z, with an optional bump in the middle
+void makeGrid(int N, float bump, std::vector<Vec3f>& positions, std::vector<uint32_t>& indices)
+{
+  for(int y = 0; y <= N; ++y)
+  {
+    for(int x = 0; x <= N; ++x)
+    {
+      const float dx = x - N * 0.5f;
+      const float dy = y - N * 0.5f;
+      positions.push_back(Vec3f(x, y, bump * exp(-(dx * dx + dy * dy) / N)));
+    }
+  }
+
+  for(int y = 0; y < N; ++y)
+  {
+    for(int x = 0; x < N; ++x)
+    {
+      const uint32_t i = x + y * (N + 1);
+      const uint32_t tri[] = { i, i + 1, i + N + 2, i, i + N + 2, i + N + 1 };
+      indices.insert(indices.end(), tri, tri + 6);
+    }
+  }
+}
+
+bool isBorder(Vec3f p, int N)
+{
+  return p.x == 0 || p.y == 0 || p.x == N || p.y == N;
+}
+}
+
+unittest("MeshSimplify: flat grid")
+{
+  const int N = 16;
+  std::vector<Vec3f> positions;
+  std::vector<uint32_t> indices;
+  makeGrid(N, 0, positions, indices);
+
+  float error = -1;
+  auto simplified = simplifyMesh(indices, positions, 0, error);
+
+  // only the border vertices are locked: the interior goes away
+  assertTrue(simplified.size() < indices.size() / 4);
+  assertEquals(0.0f, error);
+
+  std::vector<bool> used(positions.size());
+
+  for(int i = 0; i < (int)simplified.size(); i += 3)
+  {
+    auto a = positions[simplified[i + 0]];
+    auto b = positions[simplified[i + 1]];
+    auto c = positions[simplified[i + 2]];
+
+    // not flipped
+    assertTrue(crossProduct(b - a, c - a).z > 0);
+
+    for(int k = 0; k < 3; ++k)
+      used[simplified[i + k]] = true;
+  }
+
+  // borders don't move
+  for(int i = 0; i < (int)positions.size(); ++i)
+    if(isBorder(positions[i], N))
+      assertTrue(used[i]);
+}
+
+unittest("MeshSimplify: error grows as the triangles go")
+{
+  const int N = 16;
+  std::vector<Vec3f> positions;
+  std::vector<uint32_t> indices;
+  makeGrid(N, 4, positions, indices);
+
+  const int triangleCount = indices.size() / 3;
+
+  float fineError, coarseError;
+  auto fine = simplifyMesh(indices, positions, triangleCount / 2, fineError);
+  auto coarse = simplifyMesh(indices, positions, triangleCount / 8, coarseError);
+
+  assertEquals(triangleCount / 2, (int)fine.size() / 3);
+  assertTrue(coarse.size() < fine.size());
+  assertTrue(fineError < coarseError);
+
+  // in the order of the bump height. The distances to the original planes
+  // can go a bit past it: the planes go on beyond their triangles.
+  assertTrue(coarseError < 4 * 1.5);
+}
+
+unittest("MeshSimplify: the error isn't averaged away")
+{
+  // a flat grid, with a single vertex one unit up
+  const int N = 8;
+  const uint32_t peak = N / 2 * (N + 1) + N / 2;
+  std::vector<Vec3f> positions;
+  std::vector<uint32_t> indices;
+  makeGrid(N, 0, positions, indices);
+  positions[peak].z = 1;
+
+  float error;
+  auto simplified = simplifyMesh(indices, positions, N * N, error);
+
+  bool peakUsed = false;
+
+  for(auto index : simplified)
+    peakUsed |= index == peak;
+
+  // the peak is flattened: some surface moved by a whole unit
+  assertTrue(!peakUsed);
+  assertTrue(error >= 1);
+}
@@ -0,0 +1,72 @@
+// Copyright (C) 2026 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+#include "misc/pvs.h"
+#include "tests.h"
+#include <vector>
+
+namespace
+{
+// A wall at x=12, and two tiny triangles setting the grid bounds
+// to x=[0;40[, y=[0;16[, z=[0;16[.
+Pvs computeWallPvs()
+{
+  const std::vector<Vec3f> occluders =
+  {
+    Vec3f(12, 0, 0), Vec3f(12, 8, 0), Vec3f(12, 8, 8),
+    Vec3f(12, 0, 0), Vec3f(12, 8, 8), Vec3f(12, 0, 8),
+    Vec3f(0, 0, 0), Vec3f(0.1, 0, 0), Vec3f(0, 0.1, 0),
+    Vec3f(32, 0, 0), Vec3f(32, 0.1, 0), Vec3f(32, 0, 0.1),
+  };
+
+  return computePvs(occluders, 8);
+}
+}
+
+unittest("PVS: cells")
+{
+  auto const pvs = computeWallPvs();
+
+  assertEquals(5 * 2 * 2, pvs.cellCount());
+  assertEquals(0, pvs.getCell(Vec3f(4, 4, 4)));
+  assertEquals(4, pvs.getCell(Vec3f(36, 4, 4)));
+  assertEquals(-1, pvs.getCell(Vec3f(-1, 4, 4)));
+  assertEquals(-1, pvs.getCell(Vec3f(4, 4, 17)));
+}
+
+unittest("PVS: walls hide cells")
+{
+  auto const pvs = computeWallPvs();
+
+  auto isVisible = [&] (Vec3f a, Vec3f b)
+    {
+      return pvs.isVisible(pvs.getCell(a), pvs.getCell(b));
+    };
+
+  assertTrue(isVisible(Vec3f(4, 4, 4), Vec3f(4, 4, 4)));
+  assertTrue(isVisible(Vec3f(4, 4, 4), Vec3f(12, 4, 4))); // neighbours
+  assertTrue(!isVisible(Vec3f(4, 4, 4), Vec3f(28, 4, 4))); // behind the wall
+  assertTrue(!isVisible(Vec3f(28, 4, 4), Vec3f(4, 4, 4)));
+  assertTrue(isVisible(Vec3f(4, 12, 4), Vec3f(28, 12, 4))); // above the wall
+  assertTrue(isVisible(Vec3f(20, 4, 4), Vec3f(36, 4, 4))); // same side
+
+  const int from = pvs.getCell(Vec3f(4, 4, 4));
+  assertTrue(!pvs.isBoxVisible(from, Vec3f(25, 1, 1), Vec3f(30, 2, 2)));
+  assertTrue(pvs.isBoxVisible(from, Vec3f(25, 1, 1), Vec3f(30, 9, 2)));
+}
+
+unittest("PVS: serialization")
+{
+  auto const pvs = computeWallPvs();
+  auto const data = serializePvs(pvs);
+  auto const pvs2 = deserializePvs(data);
+
+  assertEquals(pvs.cellSize, pvs2.cellSize);
+  assertEquals(pvs.cellCount(), pvs2.cellCount());
+  assertEquals(pvs.bits, pvs2.bits);
+
+  assertThrown(deserializePvs(Span<const uint8_t>(data.data(), 10)));
+}
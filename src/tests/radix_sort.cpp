@@ -0,0 +1,62 @@
+// Copyright (C) 2026 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+#include "misc/radix_sort.h"
+#include "tests.h"
+#include <algorithm>
+#include <vector>
+
+unittest("RadixSort: sorts 64-bit keys")
+{
+  std::vector<SortEntry> entries;
+  uint64_t seed = 88172645463325252ull;
+
+  for(int i = 0; i < 1000; ++i)
+  {
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+    entries.push_back({ seed, i });
+  }
+
+  auto expected = entries;
+  std::sort(expected.begin(), expected.end(), [] (SortEntry a, SortEntry b) { return a.key < b.key; });
+
+  std::vector<SortEntry> scratch(entries.size());
+  radixSort(entries, scratch);
+
+  for(int i = 0; i < (int)entries.size(); ++i)
+    assertEquals(expected[i].index, entries[i].index);
+}
+
+unittest("RadixSort: stable")
+{
+  std::vector<SortEntry> entries =
+  {
+    { 0x300000000ull, 0 },
+    { 0x100000000ull, 1 },
+    { 0x300000000ull, 2 },
+    { 0x100000000ull, 3 },
+    { 0x200000000ull, 4 },
+  };
+
+  std::vector<SortEntry> scratch(entries.size());
+  radixSort(entries, scratch);
+
+  assertEquals(1, entries[0].index);
+  assertEquals(3, entries[1].index);
+  assertEquals(4, entries[2].index);
+  assertEquals(0, entries[3].index);
+  assertEquals(2, entries[4].index);
+}
+
+unittest("RadixSort: empty")
+{
+  std::vector<SortEntry> entries;
+  std::vector<SortEntry> scratch;
+  radixSort(entries, scratch);
+  assertEquals(0, (int)entries.size());
+}
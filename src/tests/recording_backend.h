@@ -0,0 +1,142 @@
+// Copyright (C) 2026 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+// Graphics backend that doesn't draw anything,
+// but records the draw calls it receives.
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "base/span.h"
+#include "engine/graphics_backend.h"
+#include "render/picture.h"
+
+struct RecordingBackend : IGraphicsBackend
+{
+  struct Program : IGpuProgram
+  {
+    std::string name;
+  };
+
+  struct Texture : ITexture
+  {
+    Texture(RecordingBackend* backend) : backend(backend) {}
+    void upload(PictureView) override {}
+    void uploadMipChain(CookedTexture const&, int) override {}
+    void setNoRepeat() override {}
+    void bind(int) override { ++backend->stateChanges; }
+    RecordingBackend* const backend;
+  };
+
+  struct VertexBuffer : IVertexBuffer
+  {
+    VertexBuffer(RecordingBackend* backend) : backend(backend) {}
+    void upload(const void*, size_t) override { ++backend->vertexUploads; }
+    void update(size_t, const void*, size_t) override { ++backend->vertexUploads; }
+    RecordingBackend* const backend;
+  };
+
+  struct IndexBuffer : IIndexBuffer
+  {
+    void upload(const void*, int, int) override {}
+  };
+
+  struct FrameBuffer : IFrameBuffer
+  {
+    FrameBuffer(RecordingBackend* backend) : texture(backend) {}
+    ITexture* getColorTexture() override { return &texture; }
+    Texture texture;
+  };
+
+  struct UniformUpload
+  {
+    std::string program;
+    int size;
+    int binding;
+  };
+
+  struct DrawCall
+  {
+    std::string program;
+    int vertexCount;
+    int firstVertex;
+    int instanceCount;
+  };
+
+  void setFullscreen(bool) override {}
+  void setCaption(String) override {}
+  void enableGrab(bool) override {}
+  void readPixels(Span<uint8_t>) override {}
+
+  std::unique_ptr<ITexture> createTexture() override { return std::make_unique<Texture>(this); }
+  std::unique_ptr<IVertexBuffer> createVertexBuffer(bool) override { return std::make_unique<VertexBuffer>(this); }
+  std::unique_ptr<IIndexBuffer> createIndexBuffer() override { return std::make_unique<IndexBuffer>(); }
+  std::unique_ptr<IFrameBuffer> createFrameBuffer(Vec2i, bool) override { return std::make_unique<FrameBuffer>(this); }
+
+  std::unique_ptr<IGpuProgram> createGpuProgram(String name, bool) override
+  {
+    auto r = std::make_unique<Program>();
+    r->name.assign(name.data, name.len);
+    return r;
+  }
+
+  void setScreenSizeListener(IScreenSizeListener* listener) override
+  {
+    listener->onScreenSizeChanged(Vec2i(1280, 720));
+  }
+
+  void setRenderTarget(IFrameBuffer*) override {}
+  void useGpuProgram(IGpuProgram* program) override { currProgram = static_cast<Program*>(program); ++stateChanges; }
+  void useVertexBuffer(IVertexBuffer*) override { ++stateChanges; }
+  void useIndexBuffer(IIndexBuffer*) override { ++stateChanges; }
+  void enableVertexAttribute(int, int, int, int, AttributeFormat) override { ++stateChanges; }
+  void setUniformBlock(void*, size_t size, int binding) override { uniformUploads.push_back({ currProgram ? currProgram->name : "", (int)size, binding }); }
+  void draw(int vertexCount, int firstVertex) override { drawInstanced(vertexCount, 1, firstVertex); }
+  void enableInstanceAttribute(int, int, int, int) override { ++stateChanges; }
+  void drawInstanced(int vertexCount, int instanceCount, int firstVertex) override { draws.push_back({ currProgram ? currProgram->name : "", vertexCount, firstVertex, instanceCount }); }
+  void drawIndexedInstanced(int indexCount, int instanceCount, int firstIndex) override { drawInstanced(indexCount, instanceCount, firstIndex); }
+  void clear() override {}
+  void swap() override {}
+
+  int countDraws(std::string program) const
+  {
+    int r = 0;
+
+    for(auto& call : draws)
+      r += call.program == program;
+
+    return r;
+  }
+
+  int countInstances(std::string program) const
+  {
+    int r = 0;
+
+    for(auto& call : draws)
+      if(call.program == program)
+        r += call.instanceCount;
+
+    return r;
+  }
+
+  int countUniformUploads(std::string program, int binding) const
+  {
+    int r = 0;
+
+    for(auto& upload : uniformUploads)
+      r += upload.program == program && upload.binding == binding;
+
+    return r;
+  }
+
+  Program* currProgram = nullptr;
+  int stateChanges = 0; // program, vertex/index buffer, vertex attribute and texture bindings
+  int vertexUploads = 0;
+  std::vector<DrawCall> draws;
+  std::vector<UniformUpload> uniformUploads;
+};
@@ -0,0 +1,379 @@
+// Copyright (C) 2026 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+#include "base/matrix4.h"
+#include "engine/renderer.h"
+#include "engine/rendermesh.h"
+#include "engine/state_filter.h"
+#include "render/frustum.h"
+#include "render/sort_key.h"
+#include "recording_backend.h"
+#include "tests.h"
+#include <cmath>
+#include <memory>
+
+IRenderer* createRenderer(IGraphicsBackend* backend);
+
+unittest("Renderer: frustum test")
+{
+  // camera at the origin, looking towards -z
+  auto const VP = perspective(PI / 2, 1, 0.1, 100);
+
+  auto isVisible = [&] (Vec3f pos)
+    {
+      auto const MVP = VP * translate(pos);
+      return !isOutsideFrustum(MVP, Vec3f(-1, -1, -1), Vec3f(1, 1, 1));
+    };
+
+  assertTrue(isVisible(Vec3f(0, 0, -10)));
+  assertTrue(!isVisible(Vec3f(0, 0, 10))); // behind
+  assertTrue(!isVisible(Vec3f(0, 0, -200))); // too far
+  assertTrue(!isVisible(Vec3f(50, 0, -10))); // right
+  assertTrue(!isVisible(Vec3f(0, -50, -10))); // below
+  assertTrue(isVisible(Vec3f(10.5, 0, -10))); // partially visible
+}
+
+unittest("Renderer: meshes outside of the view are culled")
+{
+  RecordingBackend backend;
+  std::unique_ptr<IRenderer> renderer(createRenderer(&backend));
+
+  renderer->loadModel(0, "nonexistent.render"); // falls back on a box
+  renderer->setCamera(Vec3f(0, 0, 0), Quaternion::identity()); // looking towards +x
+
+  renderer->beginDraw();
+  renderer->drawActor(Rect3f(Vec3f(5, 0, 0), Vec3f(1, 1, 1)), Quaternion::identity(), 0, false);
+  renderer->drawActor(Rect3f(Vec3f(-5, 0, 0), Vec3f(1, 1, 1)), Quaternion::identity(), 0, false);
+  renderer->drawActor(Rect3f(Vec3f(5, 50, 0), Vec3f(1, 1, 1)), Quaternion::identity(), 0, false);
+  renderer->drawActor(Rect3f(Vec3f(0, 0, 0), Vec3f(1, 1, 1)), Quaternion::identity(), 0, false);
+  renderer->endDraw();
+
+  // only the ones in front of the camera, or around it, are drawn
+  assertEquals(2, backend.countInstances("mesh"));
+}
+
+unittest("Renderer: instances of the same mesh are drawn at once")
+{
+  RecordingBackend backend;
+  std::unique_ptr<IRenderer> renderer(createRenderer(&backend));
+
+  renderer->loadModel(0, "nonexistent.render");
+  renderer->loadModel(1, "nonexistent2.render");
+  renderer->setCamera(Vec3f(0, 0, 0), Quaternion::identity());
+
+  renderer->beginDraw();
+
+  for(int i = 0; i < 100; ++i)
+    renderer->drawActor(Rect3f(Vec3f(5, i * 0.03, 0), Vec3f(1, 1, 1)), Quaternion::identity(), i % 2, false);
+
+  renderer->drawActor(Rect3f(Vec3f(5, 0, 0), Vec3f(1, 1, 1)), Quaternion::identity(), 0, true);
+
+  renderer->endDraw();
+
+  // one draw per model, plus the blinking one
+  assertEquals(3, backend.countDraws("mesh"));
+  assertEquals(101, backend.countInstances("mesh"));
+}
+
+unittest("Renderer: lights and camera are uploaded once per frame")
+{
+  RecordingBackend backend;
+  std::unique_ptr<IRenderer> renderer(createRenderer(&backend));
+
+  renderer->loadModel(0, "nonexistent.render");
+  renderer->loadModel(1, "nonexistent2.render");
+  renderer->setCamera(Vec3f(0, 0, 0), Quaternion::identity());
+
+  renderer->beginDraw();
+  renderer->drawActor(Rect3f(Vec3f(5, 0, 0), Vec3f(1, 1, 1)), Quaternion::identity(), 0, false);
+  renderer->drawActor(Rect3f(Vec3f(5, 1, 0), Vec3f(1, 1, 1)), Quaternion::identity(), 1, false);
+  renderer->drawActor(Rect3f(Vec3f(5, 2, 0), Vec3f(1, 1, 1)), Quaternion::identity(), 0, true);
+  renderer->endDraw();
+
+  assertEquals(3, backend.countDraws("mesh"));
+  assertEquals(1, backend.countUniformUploads("mesh", 0));
+  assertEquals(3, backend.countUniformUploads("mesh", 1));
+}
+
+unittest("Renderer: retained texts are drawn in one call each")
+{
+  RecordingBackend backend;
+  std::unique_ptr<IRenderer> renderer(createRenderer(&backend));
+
+  renderer->setText(0, "PAUSE");
+  renderer->setText(1, "SLOW-MOTION MODE");
+
+  const int uploads = backend.vertexUploads;
+
+  for(int frame = 0; frame < 3; ++frame)
+  {
+    renderer->setText(0, "PAUSE"); // unchanged
+
+    renderer->beginDraw();
+    renderer->drawText(Vec2f(0, 0), 0);
+    renderer->drawText(Vec2f(0, 2), 1);
+    renderer->endDraw();
+  }
+
+  // the glyphs didn't go to the GPU again
+  assertEquals(uploads, backend.vertexUploads);
+  assertEquals(6, backend.countDraws("text"));
+  assertEquals(16 * 6, backend.draws.back().vertexCount); // one quad per character
+
+  renderer->setText(0, "QUIT? [Y/N]");
+  assertEquals(uploads + 1, backend.vertexUploads);
+
+  assertThrown(renderer->drawText(Vec2f(0, 0), 7));
+}
+
+unittest("Renderer: state filter drops redundant state changes")
+{
+  RecordingBackend backend;
+  auto filter = createStateFilter(&backend);
+
+  auto program = filter->createGpuProgram("mesh", true);
+  auto vb1 = filter->createVertexBuffer();
+  auto vb2 = filter->createVertexBuffer();
+  auto texture = filter->createTexture();
+
+  filter->useGpuProgram(program.get());
+  filter->useGpuProgram(program.get());
+  assertEquals(1, backend.stateChanges);
+
+  texture->bind(1);
+  texture->bind(1);
+  texture->bind(2);
+  assertEquals(3, backend.stateChanges);
+
+  filter->useVertexBuffer(vb1.get());
+  filter->enableVertexAttribute(0, 3, 12, 0);
+  filter->enableVertexAttribute(0, 3, 12, 0);
+  assertEquals(5, backend.stateChanges);
+
+  // same attribute layout, but another vertex buffer: must be set again
+  filter->useVertexBuffer(vb2.get());
+  filter->enableVertexAttribute(0, 3, 12, 0);
+  assertEquals(7, backend.stateChanges);
+
+  // uploading a texture might change the texture bindings
+  texture->upload({});
+  texture->bind(1);
+  assertEquals(8, backend.stateChanges);
+
+  assertEquals(8, filter->getIssuedCount());
+  assertEquals(3, filter->getSkippedCount());
+}
+
+unittest("Renderer: state filter between the renderer and the backend")
+{
+  auto countStateChanges = [] (bool useFilter)
+    {
+      RecordingBackend backend;
+      auto filter = createStateFilter(&backend);
+      std::unique_ptr<IRenderer> renderer(createRenderer(useFilter ? (IGraphicsBackend*)filter.get() : &backend));
+
+      renderer->loadModel(0, "nonexistent.render");
+      renderer->loadModel(1, "nonexistent2.render");
+      renderer->setCamera(Vec3f(0, 0, 0), Quaternion::identity());
+
+      for(int frame = 0; frame < 3; ++frame)
+      {
+        renderer->beginDraw();
+        renderer->drawActor(Rect3f(Vec3f(5, 0, 0), Vec3f(1, 1, 1)), Quaternion::identity(), 0, false);
+        renderer->drawActor(Rect3f(Vec3f(5, 1, 0), Vec3f(1, 1, 1)), Quaternion::identity(), 1, false);
+        renderer->drawActor(Rect3f(Vec3f(5, 2, 0), Vec3f(1, 1, 1)), Quaternion::identity(), 0, true);
+        renderer->endDraw();
+      }
+
+      if(useFilter)
+        assertEquals(backend.stateChanges, filter->getIssuedCount());
+
+      return backend.stateChanges;
+    };
+
+  assertTrue(countStateChanges(true) < countStateChanges(false));
+}
+
+unittest("Renderer: sort keys")
+{
+  auto key = [] (bool translucent, int mesh, float depth)
+    {
+      SortKeyFields f {};
+      f.translucent = translucent;
+      f.mesh = mesh;
+      f.textureSet = mesh;
+      f.depth = depth;
+      return makeSortKey(f);
+    };
+
+  // opaque: by state, then front to back
+  assertTrue(key(false, 1, 10) < key(false, 1, 20));
+  assertTrue(key(false, 1, 20) < key(false, 2, 10));
+
+  // translucent: after the opaque ones, back to front
+  assertTrue(key(false, 2, 900) < key(true, 1, 900));
+  assertTrue(key(true, 2, 20) < key(true, 1, 10));
+  assertTrue(key(true, 1, 20) < key(true, 2, 20));
+
+  // the chunk count goes before the depth: the commands that can be instanced together stay together
+  auto withChunks = [] (int chunkCount, float depth)
+    {
+      SortKeyFields f {};
+      f.chunkCount = chunkCount;
+      f.depth = depth;
+      return makeSortKey(f);
+    };
+
+  assertTrue(withChunks(1, 900) < withChunks(2, 10));
+  assertTrue(withChunks(2, 10) < withChunks(2, 20));
+}
+
+unittest("Renderer: split mesh into chunks")
+{
+  auto vertex = [] (float x, float y, float z)
+    {
+      SingleRenderMesh::Vertex r {};
+      r.x = x;
+      r.y = y;
+      r.z = z;
+      return r;
+    };
+
+  SingleRenderMesh mesh;
+
+  // two triangles in the first cell, one in a far away cell
+  mesh.vertices.push_back(vertex(0, 0, 0));
+  mesh.vertices.push_back(vertex(1, 0, 0));
+  mesh.vertices.push_back(vertex(0, 1, 0));
+  mesh.vertices.push_back(vertex(20, 0, 0));
+  mesh.vertices.push_back(vertex(21, 0, 0));
+  mesh.vertices.push_back(vertex(20, 1, 0));
+  mesh.vertices.push_back(vertex(1, 1, 1));
+  mesh.vertices.push_back(vertex(2, 1, 1));
+  mesh.vertices.push_back(vertex(1, 2, 1));
+
+  splitIntoChunks(mesh, 8);
+
+  assertEquals(9, (int)mesh.vertices.size());
+  assertEquals(2, (int)mesh.chunks.size());
+
+  assertEquals(0, mesh.chunks[0].firstIndex);
+  assertEquals(6, mesh.chunks[0].indexCount);
+  assertEquals(2.0f, mesh.chunks[0].boundsMax.x);
+  assertEquals(1.0f, mesh.chunks[0].boundsMax.z);
+
+  assertEquals(6, mesh.chunks[1].firstIndex);
+  assertEquals(3, mesh.chunks[1].indexCount);
+  assertEquals(20.0f, mesh.chunks[1].boundsMin.x);
+  assertEquals(21.0f, mesh.chunks[1].boundsMax.x);
+  assertEquals(20.0f, mesh.vertices[6].x);
+}
+
+unittest("Renderer: weld mesh vertices")
+{
+  auto vertex = [] (float x, float y, float u)
+    {
+      SingleRenderMesh::Vertex r {};
+      r.x = x;
+      r.y = y;
+      r.diffuse_u = u;
+      return r;
+    };
+
+  SingleRenderMesh mesh;
+
+  // a quad, and a triangle sharing its positions, but not its uvs
+  mesh.vertices.push_back(vertex(0, 0, 0));
+  mesh.vertices.push_back(vertex(1, 0, 0));
+  mesh.vertices.push_back(vertex(1, 1, 0));
+  mesh.vertices.push_back(vertex(0, 0, 0));
+  mesh.vertices.push_back(vertex(1, 1, 0));
+  mesh.vertices.push_back(vertex(0, 1, 0));
+  mesh.vertices.push_back(vertex(0, 0, 1));
+  mesh.vertices.push_back(vertex(1, 0, 1));
+  mesh.vertices.push_back(vertex(1, 1, 1));
+
+  splitIntoChunks(mesh, 8);
+  weldVertices(mesh);
+
+  assertEquals(7, (int)mesh.vertices.size());
+  assertEquals(9, (int)mesh.indices.size());
+  assertEquals(1, (int)mesh.chunks.size());
+  assertEquals(9, mesh.chunks[0].indexCount);
+
+  // same triangles, in the same order
+  assertEquals(0, (int)mesh.indices[3]);
+  assertEquals(2, (int)mesh.indices[4]);
+  assertEquals(1.0f, mesh.vertices[mesh.indices[8]].diffuse_u);
+  assertEquals(1.0f, mesh.vertices[mesh.indices[8]].y);
+}
+
+unittest("Renderer: pack mesh vertices")
+{
+  auto vertex = [] (Vec3f pos, Vec3f normal, Vec3f tangent, float u, float v)
+    {
+      auto binormal = crossProduct(normal, tangent);
+
+      SingleRenderMesh::Vertex r {};
+      r.x = pos.x;
+      r.y = pos.y;
+      r.z = pos.z;
+      r.nx = normal.x;
+      r.ny = normal.y;
+      r.nz = normal.z;
+      r.tx = tangent.x;
+      r.ty = tangent.y;
+      r.tz = tangent.z;
+      r.bx = binormal.x;
+      r.by = binormal.y;
+      r.bz = binormal.z;
+      r.diffuse_u = u;
+      r.diffuse_v = v;
+      return r;
+    };
+
+  RenderMesh mesh;
+  mesh.singleMeshes.resize(2);
+
+  auto& first = mesh.singleMeshes[0].vertices;
+  first.push_back(vertex({ -10, 0, 5 }, { 0, 0, 1 }, { 1, 0, 0 }, 0, 0));
+  first.push_back(vertex({ 30, 2, 5 }, normalize({ 1, -2, -3 }), normalize({ 2, 1, 0 }), 8, 1));
+
+  auto& second = mesh.singleMeshes[1].vertices;
+  second.push_back(vertex({ 30, 2, 5 }, { 0, 0, -1 }, { 0, 1, 0 }, -2, 0.5));
+
+  auto expected = first;
+  expected.push_back(second[0]);
+  expected[2].bx = -expected[2].bx; // left-handed tangent frame
+  second[0].bx = -second[0].bx;
+
+  packVertices(mesh);
+
+  assertEquals(0, (int)mesh.singleMeshes[0].vertices.size());
+  assertEquals(2, (int)mesh.singleMeshes[0].packedVertices.size());
+  assertEquals(1, (int)mesh.singleMeshes[1].packedVertices.size());
+
+  // shared quantization: the common vertex is in the same place in both meshes
+  assertEquals((int)mesh.singleMeshes[0].packedVertices[1].x, (int)mesh.singleMeshes[1].packedVertices[0].x);
+
+  int i = 0;
+
+  for(auto& single : mesh.singleMeshes)
+  {
+    for(auto& packed : single.packedVertices)
+    {
+      auto a = unpackVertex(packed, single.quantization);
+      auto& b = expected[i++];
+
+      assertTrue(magnitude(Vec3f(a.x - b.x, a.y - b.y, a.z - b.z)) < 0.001);
+      assertTrue(magnitude(Vec3f(a.nx - b.nx, a.ny - b.ny, a.nz - b.nz)) < 0.001);
+      assertTrue(magnitude(Vec3f(a.tx - b.tx, a.ty - b.ty, a.tz - b.tz)) < 0.001);
+      assertTrue(magnitude(Vec3f(a.bx - b.bx, a.by - b.by, a.bz - b.bz)) < 0.001);
+      assertTrue(fabs(a.diffuse_u - b.diffuse_u) < 0.001);
+      assertTrue(fabs(a.diffuse_v - b.diffuse_v) < 0.001);
+    }
+  }
+}
@@ -0,0 +1,82 @@
+// Copyright (C) 2026 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+#include "base/view.h"
+#include "engine/replay.h"
+#include "tests.h"
+#include <vector>
+
+unittest("Replay: serialization roundtrip")
+{
+  InputRecording rec;
+  rec.seed = 0x12345678;
+  rec.finalState = 0xCAFEBABE;
+  rec.args = { "7" };
+
+  Control walk {};
+  walk.forward = true;
+
+  Control look {};
+  look.jump = true;
+  look.look_horz = 0.25;
+  look.look_vert = -0.5;
+
+  rec.ticks.insert(rec.ticks.end(), 1000, walk);
+  rec.ticks.push_back(look);
+  rec.ticks.insert(rec.ticks.end(), 10, Control {});
+
+  auto const data = serializeRecording(rec);
+
+  // runs of identical controls are stored once
+  assertTrue(data.size() < 64);
+
+  auto const rec2 = deserializeRecording(data);
+
+  assertEquals(rec.seed, rec2.seed);
+  assertEquals(rec.finalState, rec2.finalState);
+  assertEquals(rec.args, rec2.args);
+  assertEquals(1011, (int)rec2.ticks.size());
+  assertTrue(rec2.ticks[999].forward);
+  assertTrue(!rec2.ticks[999].jump);
+  assertTrue(rec2.ticks[1000].jump);
+  assertEquals(0.25f, rec2.ticks[1000].look_horz);
+  assertEquals(-0.5f, rec2.ticks[1000].look_vert);
+  assertTrue(!rec2.ticks[1010].forward);
+}
+
+unittest("Replay: invalid data")
+{
+  InputRecording rec;
+  rec.ticks.resize(5);
+
+  auto const data = serializeRecording(rec);
+
+  assertThrown(deserializeRecording(""));
+  assertThrown(deserializeRecording("NOPE"));
+  assertThrown(deserializeRecording(data.substr(0, data.size() - 1)));
+
+  // varints don't silently drop the bits above 32
+  auto const argCountPos = 4 + 1 + 4 + 4;
+  assertEquals(0, (int)data[argCountPos]);
+  auto overflow = data;
+  overflow.replace(argCountPos, 1, "\x80\x80\x80\x80\x10");
+  assertThrown(deserializeRecording(overflow));
+
+  auto tooLong = data;
+  tooLong.replace(argCountPos, 1, "\x80\x80\x80\x80\x80\x00");
+  assertThrown(deserializeRecording(tooLong));
+}
+
+unittest("Replay: state digest")
+{
+  std::vector<Actor> actors(3);
+  auto const digest = computeStateDigest(actors);
+
+  assertEquals(digest, computeStateDigest(actors));
+
+  actors[1].pos.x += 0.001;
+  assertTrue(digest != computeStateDigest(actors));
+}
@@ -0,0 +1,83 @@
+// Copyright (C) 2026 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+#include "misc/resource_cache.h"
+#include "tests.h"
+#include <memory>
+#include <stdexcept>
+
+namespace
+{
+// each resource is 'key' bytes
+struct Cache : ResourceCache<int, int>
+{
+  Cache()
+  {
+    onCacheMiss = [this] (int key, int64_t& bytes)
+      {
+        if(key < 0)
+          throw std::runtime_error("can't load");
+
+        ++loads;
+        bytes = key;
+        return std::make_unique<int>(key);
+      };
+  }
+
+  int loads = 0;
+};
+}
+
+unittest("ResourceCache: unused resources stay until over budget")
+{
+  Cache cache;
+  cache.budget = 100;
+
+  cache.fetch(10);
+  cache.fetch(20);
+  assertEquals(2, cache.loads);
+  assertEquals(30, (int)cache.getBytes());
+
+  // not used anymore, but still there
+  assertEquals(20, *cache.fetch(20));
+  assertEquals(2, cache.loads);
+  assertEquals(1, cache.stats.hits);
+  assertEquals(2, cache.stats.misses);
+
+  // over budget: the least recently used one goes first
+  cache.fetch(80);
+  assertEquals(1, cache.stats.evictions);
+  assertEquals(100, (int)cache.getBytes());
+
+  cache.fetch(10);
+  assertEquals(4, cache.loads);
+}
+
+unittest("ResourceCache: used and pinned resources don't get evicted")
+{
+  Cache cache;
+  cache.budget = 10;
+
+  auto pinned = cache.pin(5);
+  pinned.reset();
+
+  auto used = cache.fetch(20);
+  cache.fetch(30);
+
+  // over budget, but nothing can go
+  assertEquals(55, (int)cache.getBytes());
+  assertEquals(0, cache.stats.evictions);
+
+  used.reset();
+  cache.trim();
+  assertEquals(5, (int)cache.getBytes());
+  assertEquals(1, cache.getCount());
+  assertEquals(2, cache.stats.evictions);
+
+  // failed loads don't get cached
+  assertThrown(cache.fetch(-1));
+  assertEquals(1, cache.getCount());
+}
@@ -0,0 +1,59 @@
+// Copyright (C) 2026 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+#include "recording_backend.h"
+#include "render/streaming_buffer.h"
+#include "tests.h"
+
+unittest("StreamingVertexBuffer: batches follow each other, then wrap around")
+{
+  RecordingBackend backend;
+  StreamingVertexBuffer vb(&backend, 100);
+  const char data[40] {};
+
+  vb.beginFrame();
+  assertEquals(0, vb.push(data, 30, 1));
+  assertEquals(32, vb.push(data, 30, 8)); // aligned
+
+  // the GPU is still reading the first frames
+  vb.beginFrame();
+  assertEquals(62, vb.push(data, 30, 1));
+  vb.beginFrame();
+
+  // the first frame is done: its part gets reused
+  vb.beginFrame();
+  assertEquals(0, vb.push(data, 20, 1));
+  assertEquals(100, vb.getCapacity());
+}
+
+unittest("StreamingVertexBuffer: grows when the frames in flight fill it")
+{
+  RecordingBackend backend;
+  StreamingVertexBuffer vb(&backend, 100);
+  const char data[60] {};
+
+  vb.beginFrame();
+  vb.push(data, 60, 1);
+  vb.beginFrame();
+  assertEquals(0, vb.push(data, 60, 1));
+  assertEquals(200, vb.getCapacity());
+
+  // then, the same amount every frame ends up fitting without growing anymore
+  auto runFrames = [&] (int count)
+    {
+      for(int frame = 0; frame < count; ++frame)
+      {
+        vb.beginFrame();
+        vb.push(data, 60, 1);
+      }
+    };
+
+  runFrames(10);
+  const int capacity = vb.getCapacity();
+
+  runFrames(100);
+  assertEquals(capacity, vb.getCapacity());
+}
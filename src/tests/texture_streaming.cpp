@@ -0,0 +1,108 @@
+// Copyright (C) 2026 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+#include "engine/cooked_texture.h"
+#include "misc/job_queue.h"
+#include "recording_backend.h"
+#include "render/texture_streaming.h"
+#include "tests.h"
+#include <string>
+#include <vector>
+
+namespace
+{
+std::string cookSquareTexture(int size)
+{
+  TextureImage image;
+  image.dim = Vec2i(size, size);
+  image.pixels.resize(size * size * 4);
+
+  auto cooked = cookTexture({ &image, 1 });
+  return std::string(cooked.begin(), cooked.end());
+}
+
+// levels 0 and coarser
+int64_t getBytes(int size, int level)
+{
+  int64_t r = 0;
+
+  for(int dim = size >> level; dim >= 1; dim /= 2)
+    r += int64_t(dim) * dim * 4;
+
+  return r;
+}
+}
+
+unittest("TextureStreaming: coarse levels first")
+{
+  RecordingBackend backend;
+  JobQueue jobs(0);
+  TextureStreamer streamer(&backend, &jobs);
+
+  const auto file = cookSquareTexture(256);
+  streamer.readFile = [&] (String) { return file; };
+
+  auto texture = streamer.createTexture("a.tex");
+
+  // loaded in the background
+  assertEquals(-1, streamer.getResidentLevel(texture.get()));
+  assertEquals(0, jobs.poll(1000000));
+
+  // 256, 128, then 64
+  assertEquals(2, streamer.getResidentLevel(texture.get()));
+  assertEquals((int)getBytes(256, 2), (int)streamer.getResidentBytes());
+
+  // seen up close: one texel of the level 0 per pixel
+  streamer.request(texture.get(), 1.0f / 256);
+  streamer.update();
+  jobs.poll(1000000);
+  assertEquals(0, streamer.getResidentLevel(texture.get()));
+
+  // not needed anymore, but there's room: stays resident
+  streamer.update();
+  jobs.poll(1000000);
+  assertEquals(0, streamer.getResidentLevel(texture.get()));
+
+  // not streamed
+  RecordingBackend::Texture other(&backend);
+  assertEquals(-1, streamer.getResidentLevel(&other));
+}
+
+unittest("TextureStreaming: budget")
+{
+  RecordingBackend backend;
+  JobQueue jobs(0);
+  TextureStreamer streamer(&backend, &jobs);
+
+  const auto file = cookSquareTexture(256);
+  streamer.readFile = [&] (String) { return file; };
+
+  auto a = streamer.createTexture("a.tex");
+  auto b = streamer.createTexture("b.tex");
+  jobs.poll(1000000);
+
+  // only one of them fits with all its levels
+  streamer.budget = getBytes(256, 0) + getBytes(256, 2);
+
+  streamer.request(a.get(), 1.0f / 256);
+  streamer.request(b.get(), 1.0f / 256);
+  streamer.update();
+  jobs.poll(1000000);
+
+  // the biggest levels go first: both lose their level 0
+  assertTrue(streamer.getResidentBytes() <= streamer.budget);
+  assertEquals(1, streamer.getResidentLevel(a.get()));
+  assertEquals(1, streamer.getResidentLevel(b.get()));
+
+  // 'b' only: 'a' makes room for it
+  streamer.request(b.get(), 1.0f / 256);
+  streamer.update();
+  jobs.poll(1000000);
+
+  assertTrue(streamer.getResidentBytes() <= streamer.budget);
+  assertEquals(2, streamer.getResidentLevel(a.get()));
+  assertEquals(0, streamer.getResidentLevel(b.get()));
+}
@@ -0,0 +1,113 @@
+// Copyright (C) 2026 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+#include "misc/vertex_cache.h"
+#include "tests.h"
+#include <algorithm>
+#include <array>
+#include <vector>
+
+namespace
+{
+// N x N quads, 2 triangles each, in random order
+std::vector<uint32_t> shuffledGrid(int N)
+{
+  std::vector<uint32_t> indices;
+
+  for(int y = 0; y < N; ++y)
+  {
+    for(int x = 0; x < N; ++x)
+    {
+      const uint32_t i = x + y * (N + 1);
+      const uint32_t tri[] = { i, i + 1, i + N + 2, i, i + N + 2, i + N + 1 };
+      indices.insert(indices.end(), tri, tri + 6);
+    }
+  }
+
+  uint32_t seed = 2463534242u;
+
+  for(int t = (int)indices.size() / 3 - 1; t > 0; --t)
+  {
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+
+    const int other = seed % (t + 1);
+
+    for(int k = 0; k < 3; ++k)
+      std::swap(indices[t * 3 + k], indices[other * 3 + k]);
+  }
+
+  return indices;
+}
+
+std::vector<std::array<uint32_t, 3>> sortedTriangles(std::vector<uint32_t> const& indices)
+{
+  std::vector<std::array<uint32_t, 3>> r;
+
+  for(int i = 0; i + 2 < (int)indices.size(); i += 3)
+    r.push_back({ indices[i], indices[i + 1], indices[i + 2] });
+
+  std::sort(r.begin(), r.end());
+  return r;
+}
+}
+
+unittest("VertexCache: statistics")
+{
+  // a strip: every triangle but the first one reuses 2 vertices
+  std::vector<uint32_t> indices = { 0, 1, 2, 2, 1, 3, 2, 3, 4, 4, 3, 5 };
+
+  assertEquals(1.5f, computeAcmr(indices));
+  assertEquals(1.0f, computeAtvr(indices, 6));
+}
+
+unittest("VertexCache: reorder triangles for the cache")
+{
+  const int N = 32;
+  auto indices = shuffledGrid(N);
+  const auto triangles = sortedTriangles(indices);
+  const int vertexCount = (N + 1) * (N + 1);
+
+  const auto acmrBefore = computeAcmr(indices);
+  auto clusters = optimizeVertexCache(indices, vertexCount);
+
+  assertTrue(computeAcmr(indices) < 0.8f);
+  assertTrue(computeAcmr(indices) < acmrBefore / 2);
+  assertTrue(computeAtvr(indices, vertexCount) < 1.5f);
+  assertEquals(0, clusters[0]);
+
+  // same triangles, same winding
+  assertTrue(triangles == sortedTriangles(indices));
+}
+
+unittest("VertexCache: clusters facing outwards come first")
+{
+  const Vec3f positions[] =
+  {
+    // facing +Z, at the back: hidden behind the other one
+    { 0, 0, -1 }, { 1, 0, -1 }, { 0, 1, -1 },
+    // facing +Z, at the front
+    { 0, 0, 1 }, { 1, 0, 1 }, { 0, 1, 1 },
+  };
+
+  std::vector<uint32_t> indices = { 0, 1, 2, 3, 4, 5 };
+  const int clusters[] = { 0, 1 };
+
+  optimizeOverdraw(indices, clusters, positions);
+
+  assertTrue(std::vector<uint32_t>({ 3, 4, 5, 0, 1, 2 }) == indices);
+}
+
+unittest("VertexCache: renumber vertices in order of use")
+{
+  std::vector<uint32_t> indices = { 5, 2, 7, 2, 5, 0 };
+
+  auto oldIndex = optimizeVertexFetch(indices, 8);
+
+  assertTrue(std::vector<uint32_t>({ 0, 1, 2, 1, 0, 3 }) == indices);
+  assertTrue(std::vector<uint32_t>({ 5, 2, 7, 0 }) == oldIndex);
+}